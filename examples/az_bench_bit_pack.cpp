@@ -0,0 +1,70 @@
+#include "../src/az_simd.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Bit loop the kernels replace (one branch per coil).
+static void reference_pack(std::span<const std::uint8_t> bits, std::span<std::uint8_t> packed) {
+    std::fill_n(packed.begin(), (bits.size() + 7) / 8, 0);
+    for (size_t i = 0; i < bits.size(); ++i) {
+        if (bits[i] != 0) {
+            packed[i / 8] |= (1 << (i % 8));
+        }
+    }
+}
+
+static void reference_unpack(std::span<const std::uint8_t> packed, std::span<std::uint8_t> bits) {
+    for (size_t i = 0; i < bits.size(); ++i) {
+        bits[i] = (packed[i / 8] >> (i % 8)) & 0x01;
+    }
+}
+
+/**
+ * @brief Average time of one call over the given number of iterations
+ */
+template <typename Kernel>
+static double ns_per_call(size_t iterations, Kernel&& kernel) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        kernel();
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+    return elapsed.count() / iterations;
+}
+
+int main(int argc, char* argv[]) {
+    size_t iterations = argc > 1 ? std::stoul(argv[1]) : 200000;
+    constexpr size_t coils = 2000; // Largest read coils request
+
+    std::mt19937 rng(1);
+    std::vector<std::uint8_t> bits(coils);
+    for (auto& bit : bits) bit = rng() % 2;
+    std::vector<std::uint8_t> packed((coils + 7) / 8);
+    std::vector<std::uint8_t> unpacked(coils);
+    volatile std::uint8_t sink = 0;
+
+#if defined(__AVX2__)
+    const char* isa = "AVX2";
+#elif defined(__SSE2__)
+    const char* isa = "SSE2";
+#else
+    const char* isa = "none";
+#endif
+    std::cout << coils << " coils, vector kernels: " << isa << "\n";
+
+    auto report = [&](const char* name, double ns) {
+        std::cout << name << "  " << ns << " ns/frame\n";
+    };
+
+    report("pack   reference", ns_per_call(iterations, [&] { reference_pack(bits, packed); sink = packed[rng() % packed.size()]; }));
+    report("pack   scalar   ", ns_per_call(iterations, [&] { modbus::simd::scalar::pack_bits(bits, packed); sink = packed[rng() % packed.size()]; }));
+    report("pack   simd     ", ns_per_call(iterations, [&] { modbus::simd::pack_bits(bits, packed); sink = packed[rng() % packed.size()]; }));
+    report("unpack reference", ns_per_call(iterations, [&] { reference_unpack(packed, unpacked); sink = unpacked[rng() % coils]; }));
+    report("unpack scalar   ", ns_per_call(iterations, [&] { modbus::simd::scalar::unpack_bits(packed, unpacked); sink = unpacked[rng() % coils]; }));
+    report("unpack simd     ", ns_per_call(iterations, [&] { modbus::simd::unpack_bits(packed, unpacked); sink = unpacked[rng() % coils]; }));
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include "../src/az_database_interface.hpp"
+#include "../src/az_register_bank.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Mutex protected tables, same locking scheme as the az_server example database
+ */
+class MutexDatabase : public db::DatabaseInterface {
+private:
+    std::vector<uint16_t> db_registers = std::vector<uint16_t>(db::REGISTER_BANK_SIZE);
+    std::vector<uint16_t> db_input_registers = std::vector<uint16_t>(db::REGISTER_BANK_SIZE);
+    std::mutex mtx_;
+
+    std::vector<uint16_t>& table(db::DbType type) {
+        return (type == db::DbType::REGISTER) ? db_registers : db_input_registers;
+    }
+
+public:
+    bool connect() override {return true;}
+    bool release() override {return true;}
+    bool db_create(std::uint16_t) override {return true;}
+    bool db_delete(db::DbType, std::uint16_t) override {return true;}
+
+    std::variant<uint8_t, uint16_t> db_read(db::DbType type, std::uint16_t id) override {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return table(type).at(id);
+    }
+
+    bool db_update(db::DbType type, std::uint16_t id, std::variant<uint8_t, uint16_t> value) override {
+        std::lock_guard<std::mutex> lock(mtx_);
+        table(type).at(id) = std::get<uint16_t>(value);
+        return true;
+    }
+
+    bool db_read_range(db::DbType type, std::uint16_t start, std::span<std::uint16_t> values) override {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (start + values.size() > table(type).size()) return false;
+        std::copy_n(table(type).begin() + start, values.size(), values.begin());
+        return true;
+    }
+
+    bool db_write_range(db::DbType type, std::uint16_t start, std::span<const std::uint16_t> values) override {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (start + values.size() > table(type).size()) return false;
+        std::copy(values.begin(), values.end(), table(type).begin() + start);
+        return true;
+    }
+};
+
+/**
+ * @brief Read-heavy load: N readers polling 125 register blocks, one writer
+ *        alternating single register and block updates
+ *
+ * @return completed reads per second
+ */
+static double run_load(db::DatabaseInterface& database, unsigned readers, std::chrono::milliseconds duration) {
+    std::atomic<bool> stop{false};
+    std::atomic<std::uint64_t> total_reads{0};
+
+    std::thread writer([&] {
+        std::vector<std::uint16_t> block(16);
+        std::uint16_t round = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            std::fill(block.begin(), block.end(), ++round);
+            database.db_update(db::DbType::REGISTER, round % 1000, round);
+            database.db_write_range(db::DbType::REGISTER, (round * 16) % 1000, block);
+        }
+    });
+
+    std::vector<std::thread> threads;
+    for (unsigned r = 0; r < readers; ++r) {
+        threads.emplace_back([&, r] {
+            std::vector<std::uint16_t> values(125);
+            std::uint64_t reads = 0;
+            std::uint16_t start = static_cast<std::uint16_t>(r * 125);
+            while (!stop.load(std::memory_order_relaxed)) {
+                database.db_read_range(db::DbType::REGISTER, start, values);
+                start = static_cast<std::uint16_t>((start + 125) % 1000);
+                reads++;
+            }
+            total_reads += reads;
+        });
+    }
+
+    std::this_thread::sleep_for(duration);
+    stop = true;
+    writer.join();
+    for (auto& thread : threads) thread.join();
+
+    return total_reads.load() / std::chrono::duration<double>(duration).count();
+}
+
+int main(int argc, char* argv[]) {
+    unsigned max_readers = argc > 1 ? std::stoul(argv[1]) : std::max(1u, std::thread::hardware_concurrency() - 1);
+    auto duration = std::chrono::milliseconds(argc > 2 ? std::stoul(argv[2]) : 1000);
+
+    std::cout << "readers  mutex reads/s  register bank reads/s  speedup\n";
+    for (unsigned readers = 1; readers <= max_readers; readers *= 2) {
+        MutexDatabase mutex_database;
+        auto bank = std::make_unique<db::RegisterBank>();
+
+        double mutex_rate = run_load(mutex_database, readers, duration);
+        double bank_rate = run_load(*bank, readers, duration);
+
+        std::cout << readers << "  " << static_cast<std::uint64_t>(mutex_rate)
+                  << "  " << static_cast<std::uint64_t>(bank_rate)
+                  << "  " << bank_rate / mutex_rate << "x\n";
+    }
+    return 0;
+}
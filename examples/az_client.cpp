@@ -10,7 +10,7 @@ int main() {
     try {
         modbus::ModbusContext context;
         modbus::ModbusClient client(
-            std::make_unique<modbus::AsioChannel>(context)
+            std::make_unique<modbus::AsioChannel>(context, modbus::ChannelMode::Buffered)
         );
 
         std::cout << "--- Modbus Client ---" << std::endl;
@@ -0,0 +1,54 @@
+#include "../src/az_shared_register_bank.hpp"
+#include "../src/az_modbus_protocol.hpp"
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <thread>
+
+// Field data producer: publishes input registers and discrete inputs into the
+// shared register bank served by "az_server --shared <name>".
+//
+// az_producer [name] [period-ms]
+int main(int argc, char* argv[]) {
+    const std::string name = argc > 1 ? argv[1] : "/az_modbus_bank";
+    const auto period = std::chrono::milliseconds(argc > 2 ? std::stoi(argv[2]) : 10);
+
+    try {
+        db::SharedRegisterBank bank(name);
+        std::cout << (bank.created() ? "Created " : "Attached to ") << name << std::endl;
+
+        std::array<std::uint16_t, modbus::MAX_READ_REGISTERS> registers;
+        std::array<std::uint8_t, (modbus::MAX_READ_BITS + 7) / 8> inputs;
+        auto next = std::chrono::steady_clock::now();
+        auto report = next + std::chrono::seconds(1);
+        size_t updates = 0;
+
+        for (std::uint32_t cycle = 0; ; ++cycle) {
+            // Simulated acquisition: a sine per channel and a walking bit pattern.
+            for (size_t i = 0; i < registers.size(); ++i) {
+                registers[i] = static_cast<std::uint16_t>(32768 + 32767 * std::sin((cycle + 8 * i) * 0.01));
+            }
+            inputs.fill(static_cast<std::uint8_t>(1u << (cycle % 8)));
+
+            // Each range is published atomically, the server never sees half an update.
+            bank.db_write_range(db::DbType::REGISTER_INPUT, 0, registers);
+            bank.db_write_bits(db::DbType::BITS_INPUT, 0, modbus::MAX_READ_BITS, inputs);
+            ++updates;
+
+            auto now = std::chrono::steady_clock::now();
+            if (now >= report) {
+                std::cout << "Published " << updates << " updates/s" << std::endl;
+                updates = 0;
+                report += std::chrono::seconds(1);
+            }
+            next += period;
+            std::this_thread::sleep_until(next);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Producer error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -2,20 +2,34 @@
 #include "../src/az_asio_server_transport.hpp"
 #include "../src/az_modbus_server.hpp"
 #include "../src/az_database_interface.hpp"
+#include "../src/az_bit_table.hpp"
+#include "../src/az_mapped_register_bank.hpp"
+#include "../src/az_shared_register_bank.hpp"
 
 #include <vector>
 #include <iostream>
 #include <variant>
+#include <span>
+#include <algorithm>
+#include <array>
+#include <optional>
+#include <string>
+#include <thread>
 
 class Database : public db::DatabaseInterface {
 private:
-    std::vector<uint8_t> db_bits;
-    std::vector<uint8_t> db_input_bits;
+    db::BitTable db_bits;
+    db::BitTable db_input_bits;
     std::vector<uint16_t> db_input_registers;
     std::vector<uint16_t> db_registers;
     uint8_t db_size = 0;
+    std::array<uint64_t, 4> generations_{}; // Write generation of each table, indexed by DbType
     std::mutex mtx_;
 
+    void bump(db::DbType type) {
+        ++generations_[static_cast<size_t>(type)];
+    }
+
 public:
     bool connect() override {return true;}
     bool release() override {return true;}
@@ -28,6 +42,7 @@ public:
         db_registers.resize(num_itens);
         db_input_registers.resize(num_itens);
         db_size = num_itens;
+        for (auto& generation : generations_) ++generation;
         return true;
     }
 
@@ -35,11 +50,12 @@ public:
         std::lock_guard<std::mutex> lock(mtx_);
         std::variant<uint8_t, uint16_t> value;
 
+        // Out of range ids read as 0.
         switch (type) {
-            case db::DbType::BITS: value = db_bits.at(id); break;
-            case db::DbType::BITS_INPUT:value = db_input_bits.at(id); break;
-            case db::DbType::REGISTER: value = db_registers.at(id); break;
-            case db::DbType::REGISTER_INPUT: value = db_input_registers.at(id); break;
+            case db::DbType::BITS: value = static_cast<uint8_t>(id < db_bits.size() && db_bits.get(id)); break;
+            case db::DbType::BITS_INPUT: value = static_cast<uint8_t>(id < db_input_bits.size() && db_input_bits.get(id)); break;
+            case db::DbType::REGISTER: value = id < db_registers.size() ? db_registers[id] : uint16_t{0}; break;
+            case db::DbType::REGISTER_INPUT: value = id < db_input_registers.size() ? db_input_registers[id] : uint16_t{0}; break;
             default: std::cout << "db_read invalid type\n";
         }
         return value;
@@ -53,33 +69,120 @@ public:
         else if(std::holds_alternative<uint16_t>(value))
             std::cout << "db_update id:" << id << " value:" << static_cast<int>(std::get<uint16_t>(value)) << "\n";
 
+        if (id >= db_registers.size()) return false;
+
         switch (type) {
-            case db::DbType::BITS: db_bits.at(id) = std::get<uint8_t>(value); break;
-            case db::DbType::BITS_INPUT: db_input_bits.at(id) = std::get<uint8_t>(value); break;
-            case db::DbType::REGISTER: db_registers.at(id) = std::get<uint16_t>(value); break;
-            case db::DbType::REGISTER_INPUT: db_input_registers.at(id) = std::get<uint16_t>(value); break;
+            case db::DbType::BITS: db_bits.set(id, std::get<uint8_t>(value) != 0); break;
+            case db::DbType::BITS_INPUT: db_input_bits.set(id, std::get<uint8_t>(value) != 0); break;
+            case db::DbType::REGISTER: db_registers[id] = std::get<uint16_t>(value); break;
+            case db::DbType::REGISTER_INPUT: db_input_registers[id] = std::get<uint16_t>(value); break;
             default: std::cout << "db_update invalid type\n";
         }
+        bump(type);
+        return true;
+    }
+
+    bool db_read_range(db::DbType type, std::uint16_t start, std::span<std::uint16_t> values) override {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto& table = (type == db::DbType::REGISTER) ? db_registers : db_input_registers;
+        if (start + values.size() > table.size()) return false;
+        std::copy_n(table.begin() + start, values.size(), values.begin());
         return true;
     }
+
+    bool db_write_range(db::DbType type, std::uint16_t start, std::span<const std::uint16_t> values) override {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto& table = (type == db::DbType::REGISTER) ? db_registers : db_input_registers;
+        if (start + values.size() > table.size()) return false;
+        std::copy(values.begin(), values.end(), table.begin() + start);
+        bump(type);
+        return true;
+    }
+
+    bool db_read_bits(db::DbType type, std::uint16_t start, std::uint16_t count, std::span<std::uint8_t> packed) override {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto& table = (type == db::DbType::BITS) ? db_bits : db_input_bits;
+        return table.read_packed(start, count, packed);
+    }
+
+    bool db_write_bits(db::DbType type, std::uint16_t start, std::uint16_t count, std::span<const std::uint8_t> packed) override {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto& table = (type == db::DbType::BITS) ? db_bits : db_input_bits;
+        if (!table.write_packed(start, count, packed)) return false;
+        bump(type);
+        return true;
+    }
+
+    std::optional<uint64_t> db_generation(db::DbType type) override {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return generations_[static_cast<size_t>(type)];
+    }
 };
 
-int main() {
+// Static input data for the standalone database: odd addresses read as 1, even addresses as 0.
+void seed_inputs(db::DatabaseInterface& database, std::uint16_t count) {
+    std::vector<uint16_t> registers(count);
+    std::vector<uint8_t> bits((count + 7) / 8, 0xAA);
+    for (std::uint16_t i = 0; i < count; ++i) registers[i] = i % 2;
+    database.db_write_range(db::DbType::REGISTER_INPUT, 0, registers);
+    database.db_write_bits(db::DbType::BITS_INPUT, 0, count, bits);
+}
+
+int main(int argc, char* argv[]) {
     try {
-        modbus::ModbusContext context;
-        auto database_ptr = std::make_unique<Database>();
-        database_ptr->db_create(100);
+        modbus::ModbusContext context(std::max(1u, std::thread::hardware_concurrency()));
+
+        // az_server [state-file]: with a file the tables are kept in it across restarts.
+        // az_server --shared <name>: input tables are published by az_producer through shared memory.
+        std::unique_ptr<db::DatabaseInterface> database;
+        if (argc > 2 && std::string(argv[1]) == "--shared") {
+            auto bank = std::make_unique<db::SharedRegisterBank>(argv[2]);
+            std::cout << (bank->created() ? "Created " : "Attached to ") << argv[2] << std::endl;
+            database = std::move(bank);
+        }
+        else if (argc > 1) {
+            auto bank = std::make_unique<db::MappedRegisterBank>(argv[1], db::SyncPolicy::Periodic);
+            std::cout << (bank->created() ? "Created " : "Reopened ") << argv[1] << std::endl;
+            database = std::move(bank);
+        }
+        else {
+            auto database_ptr = std::make_unique<Database>();
+            database_ptr->db_create(100);
+            seed_inputs(*database_ptr, 100);
+            database = std::move(database_ptr);
+        }
 
         modbus::ModbusServer server(
-            std::make_unique<modbus::AsioServerTransport>(context),
-            std::unique_ptr<db::DatabaseInterface>(std::move(database_ptr)),
+            std::make_unique<modbus::AsioServerTransport>(context, modbus::AcceptMode::Sharded, modbus::ChannelMode::Buffered),
+            std::move(database),
             modbus::UnitID(1)
         );
 
+        server.enable_response_cache();
+
+        // Log the holding registers written by masters, in coalesced batches.
+        auto writes = server.subscribe_writes(modbus::UnitID(1), db::DbType::REGISTER, 0, 100);
+        std::thread write_logger([writes] {
+            std::vector<modbus::WriteEvent> batch;
+            std::uint32_t signal = 0;
+            while (!writes->closed()) {
+                signal = writes->wait(signal);
+                writes->drain(batch);
+                for (const auto& event : batch) {
+                    std::cout << "[WRITE] registers " << event.start << " - " << event.start + event.count - 1 << std::endl;
+                }
+            }
+        });
+
         server.start(modbus::Ipv4("0.0.0.0"), modbus::Port("1502"));
 
         std::cout << "Servidor Modbus rodando. Pressione ENTER para parar." << std::endl;
         std::cin.get();
+        writes->close();
+        write_logger.join();
+
+        auto stats = server.response_cache_stats();
+        std::cout << "Response cache: " << stats.hits << " hits, " << stats.misses << " misses" << std::endl;
 
     } catch (const std::exception& e) {
         std::cerr << "Erro Fatal do Servidor: " << e.what() << std::endl;
@@ -5,7 +5,10 @@
 #include <asio/co_spawn.hpp>
 #include <asio/detached.hpp>
 #include <asio/read.hpp>
+#include <asio/redirect_error.hpp>
+#include <asio/steady_timer.hpp>
 #include <asio/write.hpp>
+#include <exception>
 
 namespace modbus {
 
@@ -13,10 +16,56 @@ using asio::awaitable;
 using asio::co_spawn;
 using asio::use_awaitable;
 
+/**
+ * @brief How AsioChannel moves bytes between the socket and its callers
+ *
+ * Buffered writes made while another write is in flight are queued and sent
+ * together with one gather write once it completes. Every call still returns
+ * only after its bytes were written, and a failed socket write fails every
+ * call queued in it as well as the later ones.
+ */
+enum class ChannelMode {
+    Direct,  // Every read and write is a socket operation
+    Buffered // Reads are served from a per-connection receive buffer, concurrent writes are coalesced
+};
+
 class AsioChannel : public IModbusChannel {
 private:
+    // Receive buffer of the Buffered mode, larger reads bypass it.
+    static constexpr size_t RECEIVE_BUFFER_SIZE = 16 * 1024;
+
     tcp::socket socket_;
     asio::any_io_executor executor_;
+    ChannelMode mode_;
+
+    // Buffered mode: bytes [rx_head_, rx_tail_) of rx_buffer_ are received but not yet read.
+    std::vector<std::uint8_t> rx_buffer_;
+    size_t rx_head_ = 0;
+    size_t rx_tail_ = 0;
+
+    // Buffered mode: the buffers of the frames written while a write is in
+    // flight are appended to tx_pending_ and sent together by the writer already
+    // running. Their callers wait for batch tx_sent_ to reach theirs, so the
+    // frames are referenced in place instead of copied.
+    std::vector<asio::const_buffer> tx_pending_;
+    std::vector<asio::const_buffer> tx_sending_;
+    std::uint64_t tx_batch_ = 1; // Batch tx_pending_ will be sent with
+    std::uint64_t tx_sent_ = 0;  // Last batch written
+    asio::steady_timer tx_done_;
+    bool tx_flushing_ = false;
+    std::exception_ptr tx_error_;
+
+    // Direct mode gather list, reused between batches.
+    std::vector<asio::const_buffer> tx_buffers_;
+
+    size_t socket_writes_ = 0;
+
+    // Every socket write goes through here, counted for socket_writes().
+    template <typename ConstBufferSequence>
+    awaitable<size_t> send(const ConstBufferSequence& buffers) {
+        ++socket_writes_;
+        co_return co_await asio::async_write(socket_, buffers, use_awaitable);
+    }
 
     // Internal curtain for connection.
     awaitable<void> do_connect(const std::string& host, const std::string& port) {
@@ -25,24 +74,139 @@ private:
         co_await asio::async_connect(socket_, endpoints, use_awaitable);
     }
 
+    // Sends tx_pending_ until it stays empty, only one writer runs at a time.
+    awaitable<void> flush_pending() {
+        tx_flushing_ = true;
+        try {
+            while (!tx_pending_.empty()) {
+                std::swap(tx_pending_, tx_sending_);
+                ++tx_batch_;
+                co_await send(tx_sending_);
+                tx_sending_.clear();
+                ++tx_sent_;
+                tx_done_.cancel();
+            }
+        } catch (...) {
+            // Reported to the callers queued behind and to every later writer.
+            tx_error_ = std::current_exception();
+            tx_pending_.clear();
+            tx_sending_.clear();
+            tx_flushing_ = false;
+            tx_done_.cancel();
+            throw;
+        }
+        tx_flushing_ = false;
+    }
+
+    // Queues the buffers and returns once they were written.
+    template <typename Buffers>
+    awaitable<size_t> write_queued(const Buffers& buffers) {
+        if (tx_error_) std::rethrow_exception(tx_error_);
+        size_t size = 0;
+        for (const auto& buffer : buffers) {
+            tx_pending_.push_back(asio::buffer(buffer));
+            size += tx_pending_.back().size();
+        }
+        if (!tx_flushing_) {
+            co_await flush_pending();
+            co_return size;
+        }
+
+        std::uint64_t batch = tx_batch_;
+        while (tx_sent_ < batch && !tx_error_) {
+            asio::error_code ec;
+            co_await tx_done_.async_wait(asio::redirect_error(use_awaitable, ec));
+        }
+        if (tx_sent_ < batch) std::rethrow_exception(tx_error_);
+        co_return size;
+    }
+
     // Internal writing curtain
     awaitable<size_t> do_write(const std::vector<std::uint8_t>& data) {
-        co_return co_await asio::async_write(socket_, asio::buffer(data), use_awaitable);
+        if (mode_ == ChannelMode::Direct) {
+            co_return co_await send(asio::buffer(data));
+        }
+        co_return co_await write_queued(std::span<const std::vector<std::uint8_t>>(&data, 1));
+    }
+
+    // Internal scatter-gather writing curtain
+    awaitable<size_t> do_write_buffers(std::span<const asio::const_buffer> buffers) {
+        if (mode_ == ChannelMode::Direct) {
+            co_return co_await send(buffers);
+        }
+        co_return co_await write_queued(buffers);
+    }
+
+    // Internal gather writing curtain
+    awaitable<size_t> do_write_batch(std::span<const std::vector<std::uint8_t>> frames) {
+        if (mode_ == ChannelMode::Direct) {
+            tx_buffers_.clear();
+            for (const auto& frame : frames) {
+                tx_buffers_.push_back(asio::buffer(frame));
+            }
+            co_return co_await send(tx_buffers_);
+        }
+        co_return co_await write_queued(frames);
     }
 
     // Internal curtain for reading
     awaitable<std::vector<std::uint8_t>> do_read(size_t bytes_to_read) {
         std::vector<std::uint8_t> buffer(bytes_to_read);
-        co_await asio::async_read(socket_, asio::buffer(buffer), use_awaitable);
+        if (mode_ == ChannelMode::Direct) {
+            co_await asio::async_read(socket_, asio::buffer(buffer), use_awaitable);
+            co_return buffer;
+        }
+        for (size_t done = 0; done < bytes_to_read; ) {
+            done += co_await do_read_some(std::span<std::uint8_t>(buffer).subspan(done));
+        }
         co_return buffer;
     }
 
+    // Internal curtain for partial reads
+    awaitable<size_t> do_read_some(std::span<std::uint8_t> buffer) {
+        if (mode_ == ChannelMode::Direct || (rx_head_ == rx_tail_ && buffer.size() >= rx_buffer_.size())) {
+            co_return co_await socket_.async_read_some(asio::buffer(buffer.data(), buffer.size()), use_awaitable);
+        }
+        if (rx_head_ == rx_tail_) {
+            rx_head_ = 0;
+            rx_tail_ = co_await socket_.async_read_some(asio::buffer(rx_buffer_), use_awaitable);
+        }
+        size_t count = std::min(buffer.size(), rx_tail_ - rx_head_);
+        std::copy_n(rx_buffer_.begin() + rx_head_, count, buffer.begin());
+        rx_head_ += count;
+        co_return count;
+    }
+
+    void init_buffers() {
+        if (mode_ == ChannelMode::Buffered) {
+            rx_buffer_.resize(RECEIVE_BUFFER_SIZE);
+        }
+    }
+
 public:
-    AsioChannel(ModbusContext& context)
-        : socket_(context.get_executor()), executor_(context.get_executor()) {}
+    // Client channel, bound to the next io_context of the pool.
+    AsioChannel(ModbusContext& context, ChannelMode mode = ChannelMode::Direct)
+        : socket_(context.next_io_context()), executor_(socket_.get_executor()), mode_(mode),
+          tx_done_(executor_, asio::steady_timer::time_point::max()) {
+        init_buffers();
+    }
+
+    AsioChannel(tcp::socket socket, ChannelMode mode = ChannelMode::Direct)
+        : socket_(std::move(socket)), executor_(socket_.get_executor()), mode_(mode),
+          tx_done_(executor_, asio::steady_timer::time_point::max()) {
+        init_buffers();
+    }
+
+    ChannelMode mode() const {
+        return mode_;
+    }
 
-    AsioChannel(tcp::socket socket)
-        : socket_(std::move(socket)), executor_(socket_.get_executor()) {}
+    /**
+     * @brief Number of socket writes started, lower than the number of frames written when Buffered mode coalesces them
+     */
+    size_t socket_writes() const {
+        return socket_writes_;
+    }
 
     std::future<void> connect(const std::string& host, const std::string& port) override {
         return co_spawn(executor_, do_connect(host, port), asio::use_future);
@@ -56,6 +220,10 @@ public:
         return co_spawn(executor_, do_read(bytes_to_read), asio::use_future);
     }
 
+    std::future<size_t> read_some(std::span<std::uint8_t> buffer) override {
+        return co_spawn(executor_, do_read_some(buffer), asio::use_future);
+    }
+
     void close() override {
         if (socket_.is_open()) {
             asio::error_code ec;
@@ -64,14 +232,40 @@ public:
         }
     }
 
+    awaitable<void> co_connect(const std::string& host, const std::string& port) override {
+        co_await do_connect(host, port);
+    }
+
     awaitable<std::vector<std::uint8_t>> co_read(size_t bytes_to_read) override {
-        std::vector<std::uint8_t> buffer(bytes_to_read);
-        co_await asio::async_read(socket_, asio::buffer(buffer), asio::use_awaitable);
-        co_return buffer;
+        co_return co_await do_read(bytes_to_read);
     }
 
+    awaitable<size_t> co_read_some(std::span<std::uint8_t> buffer) override {
+        co_return co_await do_read_some(buffer);
+    }
+
+    /**
+     * @brief Write one frame
+     *
+     * In Buffered mode the call may be made while another write is in flight:
+     * the frame is sent with the next write, and the call returns once it is.
+     */
     awaitable<size_t> co_write(const std::vector<std::uint8_t>& data) override {
-        co_return co_await asio::async_write(socket_, asio::buffer(data), asio::use_awaitable);
+        co_return co_await do_write(data);
+    }
+
+    /**
+     * @brief Write a buffer sequence (e.g. header + payload of one or more frames) with one gather write
+     */
+    awaitable<size_t> co_write(std::span<const asio::const_buffer> buffers) override {
+        co_return co_await do_write_buffers(buffers);
+    }
+
+    /**
+     * @brief Write several frames with one gather write (writev)
+     */
+    awaitable<size_t> co_write_batch(std::span<const std::vector<std::uint8_t>> frames) override {
+        co_return co_await do_write_batch(frames);
     }
 
     asio::any_io_executor get_executor() override {
@@ -79,4 +273,4 @@ public:
     }
 };
 
-} // namespace modbus
\ No newline at end of file
+} // namespace modbus
@@ -4,39 +4,132 @@
 #include "az_asio_channel.hpp"
 #include <asio/co_spawn.hpp>
 #include <asio/detached.hpp>
+#include <deque>
 
 namespace modbus {
 
+/**
+ * @brief How AsioServerTransport accepts connections
+ */
+enum class AcceptMode {
+    Single,  // One acceptor, connections are spread round-robin over the ModbusContext threads
+    Sharded  // One SO_REUSEPORT acceptor per ModbusContext thread, the kernel balances the connections
+};
+
 class AsioServerTransport : public IServerTransport {
 private:
-    tcp::acceptor acceptor_;
+    // Connections accepted in one go before returning to the event loop.
+    static constexpr size_t MAX_ACCEPT_BATCH = 64;
+
+#ifdef SO_REUSEPORT
+    using reuse_port = asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+#endif
+
+    ModbusContext& context_;
+    // The accept loops refer to their acceptor, a deque keeps it in place when another call adds more.
+    std::deque<tcp::acceptor> acceptors_;
     asio::io_context::executor_type executor_;
+    AcceptMode mode_;
+    ChannelMode channel_mode_;
+
+    // Moves an accepted socket onto the io_context serving its connection.
+    static tcp::socket rehome(tcp::socket socket, asio::io_context& io) {
+        if (socket.get_executor() == asio::any_io_executor(io.get_executor())) return socket;
+        auto protocol = socket.local_endpoint().protocol();
+        return tcp::socket(io, protocol, socket.release());
+    }
+
+    /**
+     * @brief Main curtain for accepting connections
+     *
+     * After each completed accept the pending backlog is drained with non-blocking
+     * accepts (up to MAX_ACCEPT_BATCH), so a reconnection storm does not cost one
+     * event loop round trip per connection. Drained sockets are accepted on the
+     * acceptor's io_context and only then moved to their target, so an empty
+     * backlog does not use up a round-robin slot.
+     *
+     * @param acceptor listening non-blocking acceptor
+     * @param shard io_context receiving the connections, nullptr for round-robin
+     * @param handler called for every accepted connection
+     */
+    awaitable<void> do_accept(tcp::acceptor& acceptor, asio::io_context* shard, NewConnectionHandler handler) {
+        auto target = [&]() -> asio::io_context& {
+            return shard ? *shard : context_.next_io_context();
+        };
 
-    // Main curtain for accepting connections
-    awaitable<void> do_accept(NewConnectionHandler handler) {
-        acceptor_.listen();
         while (true) {
-            tcp::socket new_socket = co_await acceptor_.async_accept(use_awaitable);
-            handler(std::make_unique<AsioChannel>(std::move(new_socket)));
+            tcp::socket new_socket = co_await acceptor.async_accept(target(), use_awaitable);
+            handler(std::make_unique<AsioChannel>(std::move(new_socket), channel_mode_));
+
+            for (size_t i = 1; i < MAX_ACCEPT_BATCH; ++i) {
+                asio::error_code ec;
+                tcp::socket pending = acceptor.accept(ec);
+                if (ec) {
+                    // Backlog empty (would_block), other errors are reported by the next async_accept.
+                    break;
+                }
+                handler(std::make_unique<AsioChannel>(rehome(std::move(pending), target()), channel_mode_));
+            }
         }
     }
 
 public:
-    AsioServerTransport(ModbusContext& context)
-        : executor_(context.get_executor()),
-          acceptor_(context.get_io_context()) {}
+    /**
+     * @param context worker threads serving the accepted connections
+     * @param mode Sharded needs SO_REUSEPORT, without it the transport falls back to Single
+     * @param channel_mode mode of the accepted connections
+     */
+    AsioServerTransport(ModbusContext& context, AcceptMode mode = AcceptMode::Single, ChannelMode channel_mode = ChannelMode::Direct)
+        : context_(context),
+          executor_(context.get_executor()),
+          mode_(mode),
+          channel_mode_(channel_mode) {
+#ifndef SO_REUSEPORT
+        mode_ = AcceptMode::Single;
+#endif
+    }
 
+    /**
+     * @brief Bind and start the accept loops
+     *
+     * In Sharded mode the handler is called from every worker thread. Each call
+     * adds the acceptors of another endpoint, the earlier ones keep running.
+     *
+     * @return future of the first accept loop, it only completes on error
+     */
     std::future<void> start_accepting(const std::string& ipv4, const std::string& port, NewConnectionHandler handler) override {
         tcp::resolver resolver(executor_);
         auto endpoints = resolver.resolve(ipv4, port);
         asio::ip::tcp::endpoint endpoint = *endpoints.begin();
-        acceptor_.open(endpoint.protocol());
-        acceptor_.set_option(tcp::acceptor::reuse_address(true));
-        acceptor_.bind(endpoint);
 
-        // It starts the acceptance coroutine, using 'detached' because the loop runs indefinitely.
-        return co_spawn(executor_, do_accept(handler), asio::use_future);
+        size_t shards = (mode_ == AcceptMode::Sharded) ? context_.size() : 1;
+        size_t first = acceptors_.size();
+        for (size_t i = 0; i < shards; ++i) {
+            auto& acceptor = acceptors_.emplace_back(context_.get_io_context(i));
+            acceptor.open(endpoint.protocol());
+            acceptor.set_option(tcp::acceptor::reuse_address(true));
+#ifdef SO_REUSEPORT
+            if (mode_ == AcceptMode::Sharded) {
+                acceptor.set_option(reuse_port(true));
+            }
+#endif
+            acceptor.bind(endpoint);
+            // Listening before returning, connections made once start_accepting() returns are queued.
+            acceptor.listen();
+            acceptor.non_blocking(true);
+        }
+
+        // Shards accept onto their own io_context, so a connection never changes thread.
+        auto shard = [&](size_t i) {
+            return (mode_ == AcceptMode::Sharded) ? &context_.get_io_context(i) : nullptr;
+        };
+        for (size_t i = 1; i < shards; ++i) {
+            auto& acceptor = acceptors_[first + i];
+            co_spawn(acceptor.get_executor(), do_accept(acceptor, shard(i), handler), asio::detached);
+        }
+        auto& acceptor = acceptors_[first];
+        return co_spawn(acceptor.get_executor(), do_accept(acceptor, shard(0), handler), asio::use_future);
     }
 };
 
-} // namespace modbus
\ No newline at end of file
+} // namespace modbus
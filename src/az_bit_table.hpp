@@ -0,0 +1,199 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+namespace db {
+
+/**
+ * @brief Word level kernels over bit tables stored 64 addresses per word
+ *
+ * Address i lives in bit (i % 64) of word (i / 64). The Modbus packed format
+ * is LSB first, so on a little endian host a word is also its own packed form
+ * and ranges are converted with shifts, never bit by bit.
+ */
+namespace bits {
+
+constexpr size_t WORD_BITS = 64;
+
+/**
+ * @brief Number of words holding count addresses
+ */
+constexpr size_t word_count(size_t count) {
+    return (count + WORD_BITS - 1) / WORD_BITS;
+}
+
+inline std::uint64_t low_mask(size_t count) {
+    return count >= WORD_BITS ? ~std::uint64_t{0} : (std::uint64_t{1} << count) - 1;
+}
+
+/**
+ * @brief Load up to 8 bytes as a little endian word
+ */
+inline std::uint64_t load_le(const std::uint8_t* bytes, size_t size) {
+    std::uint64_t word = 0;
+    std::memcpy(&word, bytes, size);
+    if constexpr (std::endian::native == std::endian::big) {
+        word = std::byteswap(word);
+    }
+    return word;
+}
+
+/**
+ * @brief Store the low size bytes of a word in little endian order
+ */
+inline void store_le(std::uint8_t* bytes, std::uint64_t word, size_t size) {
+    if constexpr (std::endian::native == std::endian::big) {
+        word = std::byteswap(word);
+    }
+    std::memcpy(bytes, &word, size);
+}
+
+/**
+ * @brief Bits [bit, bit + count) of a packed buffer as the low bits of a word
+ *
+ * @param packed Modbus packed bits, at least (bit + count + 7) / 8 bytes
+ * @param bit first bit
+ * @param count number of bits, at most 64
+ */
+inline std::uint64_t extract_packed(std::span<const std::uint8_t> packed, size_t bit, size_t count) {
+    size_t first = bit / 8;
+    size_t shift = bit % 8;
+    size_t bytes = (shift + count + 7) / 8; // Up to 9 bytes
+    std::uint64_t word = load_le(packed.data() + first, std::min<size_t>(bytes, 8)) >> shift;
+    if (bytes > 8) {
+        word |= std::uint64_t{packed[first + 8]} << (WORD_BITS - shift);
+    }
+    return word & low_mask(count);
+}
+
+/**
+ * @brief Copy addresses [start, start + count) into the Modbus packed format
+ *
+ * @param words table words, word 0 holds address 0
+ * @param start first address
+ * @param count number of addresses
+ * @param packed output, at least (count + 7) / 8 bytes; unused high bits of the last byte are cleared
+ */
+inline void read_packed(std::span<const std::uint64_t> words, size_t start, size_t count, std::span<std::uint8_t> packed) {
+    size_t index = start / WORD_BITS;
+    size_t shift = start % WORD_BITS;
+    for (size_t done = 0; done < count; done += WORD_BITS, ++index) {
+        size_t chunk = std::min(WORD_BITS, count - done);
+        std::uint64_t word = words[index] >> shift;
+        if (shift != 0 && shift + chunk > WORD_BITS) {
+            word |= words[index + 1] << (WORD_BITS - shift);
+        }
+        store_le(packed.data() + done / 8, word & low_mask(chunk), (chunk + 7) / 8);
+    }
+}
+
+/**
+ * @brief New value of one table word after writing [start, start + count) from packed bits
+ *
+ * Bits of the word outside the range keep their current value.
+ *
+ * @param current current value of the word
+ * @param index index of the word in the table
+ * @param start first address written
+ * @param count number of addresses written
+ * @param packed Modbus packed bits, at least (count + 7) / 8 bytes
+ */
+inline std::uint64_t merge_word(std::uint64_t current, size_t index, size_t start, size_t count, std::span<const std::uint8_t> packed) {
+    size_t word_start = index * WORD_BITS;
+    size_t first = std::max(start, word_start);
+    size_t last = std::min(start + count, word_start + WORD_BITS);
+    if (first >= last) return current;
+
+    size_t shift = first - word_start;
+    std::uint64_t mask = low_mask(last - first) << shift;
+    std::uint64_t value = extract_packed(packed, first - start, last - first) << shift;
+    return (current & ~mask) | value;
+}
+
+/**
+ * @brief Write addresses [start, start + count) from the Modbus packed format
+ *
+ * @param words table words, word 0 holds address 0
+ * @param start first address
+ * @param count number of addresses
+ * @param packed Modbus packed bits, at least (count + 7) / 8 bytes
+ */
+inline void write_packed(std::span<std::uint64_t> words, size_t start, size_t count, std::span<const std::uint8_t> packed) {
+    if (count == 0) return;
+    for (size_t index = start / WORD_BITS; index <= (start + count - 1) / WORD_BITS; ++index) {
+        words[index] = merge_word(words[index], index, start, count, packed);
+    }
+}
+
+} // namespace bits
+
+/**
+ * @brief Coil / discrete input table, 64 addresses per 64-bit word
+ *
+ * Not thread safe, see RegisterBank for concurrent access.
+ */
+class BitTable {
+private:
+    std::vector<std::uint64_t> words_;
+    size_t size_ = 0;
+
+    bool in_range(size_t start, size_t count) const {
+        return start + count <= size_;
+    }
+
+public:
+    explicit BitTable(size_t size = 0) {
+        resize(size);
+    }
+
+    /**
+     * @brief Set the number of addresses, every address is cleared
+     */
+    void resize(size_t size) {
+        words_.assign(bits::word_count(size), 0);
+        size_ = size;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    bool get(size_t id) const {
+        return (words_[id / bits::WORD_BITS] >> (id % bits::WORD_BITS)) & 1;
+    }
+
+    void set(size_t id, bool value) {
+        std::uint64_t mask = std::uint64_t{1} << (id % bits::WORD_BITS);
+        auto& word = words_[id / bits::WORD_BITS];
+        word = value ? (word | mask) : (word & ~mask);
+    }
+
+    /**
+     * @brief Copy [start, start + count) into the Modbus packed format
+     *
+     * @return false when the range is out of the table
+     */
+    bool read_packed(size_t start, size_t count, std::span<std::uint8_t> packed) const {
+        if (!in_range(start, count)) return false;
+        bits::read_packed(words_, start, count, packed);
+        return true;
+    }
+
+    /**
+     * @brief Write [start, start + count) from the Modbus packed format
+     *
+     * @return false when the range is out of the table
+     */
+    bool write_packed(size_t start, size_t count, std::span<const std::uint8_t> packed) {
+        if (!in_range(start, count)) return false;
+        bits::write_packed(words_, start, count, packed);
+        return true;
+    }
+};
+
+} // namespace db
@@ -1,6 +1,9 @@
-
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <span>
 #include <variant>
 
 namespace db{
@@ -21,5 +24,92 @@ public:
     virtual std::variant<std::uint8_t, std::uint16_t> db_read(db::DbType type, std::uint16_t id) = 0;
     virtual bool db_update(db::DbType type, std::uint16_t id, std::variant<std::uint8_t, std::uint16_t> value) = 0;
     virtual bool db_delete(DbType type, std::uint16_t id) = 0;
+
+    /**
+     * @brief Read a register range [start, start + values.size())
+     *
+     * The default implementation falls back to one db_read per register,
+     * implementations should override it to serve the whole range at once.
+     *
+     * @param type REGISTER or REGISTER_INPUT
+     * @param start first address
+     * @param values output buffer (host endian)
+     * @return false when the range is out of the table
+     */
+    virtual bool db_read_range(db::DbType type, std::uint16_t start, std::span<std::uint16_t> values) {
+        if (start + values.size() > 0x10000) return false;
+        for (size_t i = 0; i < values.size(); ++i) {
+            values[i] = std::get<std::uint16_t>(db_read(type, static_cast<std::uint16_t>(start + i)));
+        }
+        return true;
+    }
+
+    /**
+     * @brief Write a register range [start, start + values.size())
+     *
+     * @param type REGISTER or REGISTER_INPUT
+     * @param start first address
+     * @param values register values (host endian)
+     * @return false when the range is out of the table
+     */
+    virtual bool db_write_range(db::DbType type, std::uint16_t start, std::span<const std::uint16_t> values) {
+        if (start + values.size() > 0x10000) return false;
+        for (size_t i = 0; i < values.size(); ++i) {
+            if (!db_update(type, static_cast<std::uint16_t>(start + i), values[i])) return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Read a bit range into the Modbus packed representation (LSB first)
+     *
+     * @param type BITS or BITS_INPUT
+     * @param start first address
+     * @param count number of bits
+     * @param packed output buffer, at least (count + 7) / 8 bytes
+     * @return false when the range is out of the table
+     */
+    virtual bool db_read_bits(db::DbType type, std::uint16_t start, std::uint16_t count, std::span<std::uint8_t> packed) {
+        if (start + size_t{count} > 0x10000) return false;
+        std::fill_n(packed.begin(), (count + 7) / 8, 0);
+        for (size_t i = 0; i < count; ++i) {
+            if (std::get<std::uint8_t>(db_read(type, static_cast<std::uint16_t>(start + i))) != 0) {
+                packed[i / 8] |= static_cast<std::uint8_t>(1 << (i % 8));
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Write a bit range from the Modbus packed representation (LSB first)
+     *
+     * @param type BITS or BITS_INPUT
+     * @param start first address
+     * @param count number of bits
+     * @param packed packed bits, at least (count + 7) / 8 bytes
+     * @return false when the range is out of the table
+     */
+    virtual bool db_write_bits(db::DbType type, std::uint16_t start, std::uint16_t count, std::span<const std::uint8_t> packed) {
+        if (start + size_t{count} > 0x10000) return false;
+        for (size_t i = 0; i < count; ++i) {
+            std::uint8_t bit = (packed[i / 8] >> (i % 8)) & 0x01;
+            if (!db_update(type, static_cast<std::uint16_t>(start + i), bit)) return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Write generation of a table
+     *
+     * Must change after every write to the table has become visible to
+     * readers, including writes made outside the Modbus server. The server
+     * caches read responses against it (ModbusServer::enable_response_cache).
+     *
+     * @param type table
+     * @return the generation, or std::nullopt when writes are not tracked and responses must not be cached
+     */
+    virtual std::optional<std::uint64_t> db_generation(db::DbType /*type*/) {
+        return std::nullopt;
+    }
 };
-}
\ No newline at end of file
+}
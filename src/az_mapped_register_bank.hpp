@@ -0,0 +1,233 @@
+#pragma once
+
+#include "az_register_bank.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace db {
+
+/**
+ * @brief When MappedRegisterBank flushes the mapping to its file
+ */
+enum class SyncPolicy {
+    None,      // Left to the kernel writeback, survives a process crash but not a power loss
+    Periodic,  // msync of the whole mapping from a background thread at a fixed interval
+    EveryWrite // msync of the written pages before the write returns
+};
+
+/**
+ * @brief Header at the start of a register bank file
+ */
+struct MappedBankHeader {
+    static constexpr char MAGIC[8] = {'A', 'Z', 'M', 'B', 'B', 'A', 'N', 'K'};
+    static constexpr std::uint32_t VERSION = 1;
+    // The layout starts on its own page so the header never shares a page with the tables.
+    static constexpr size_t LAYOUT_OFFSET = 4096;
+
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t header_size; // Offset of the layout in the file
+    std::uint64_t layout_size; // sizeof(RegisterBankLayout) of the writer
+};
+
+/**
+ * @brief RegisterBank whose tables live in a memory mapped file
+ *
+ * The file holds a MappedBankHeader followed by a RegisterBankLayout, and
+ * writes land directly in the mapping. Reopening an existing file is O(1):
+ * the tables are used as found, only the seqlock counters are reset in case
+ * the previous owner died in the middle of a range write. A file is owned by
+ * one MappedRegisterBank at a time (flock).
+ *
+ * db_create() still clears every table, check created() before calling it
+ * to keep the state of a reopened file.
+ */
+class MappedRegisterBank : public RegisterBank {
+private:
+    static constexpr size_t LAYOUT_OFFSET = MappedBankHeader::LAYOUT_OFFSET;
+    static constexpr size_t FILE_SIZE = LAYOUT_OFFSET + sizeof(RegisterBankLayout);
+
+    int fd_ = -1;
+    std::uint8_t* mapping_ = nullptr;
+    bool created_ = false;
+    SyncPolicy policy_;
+    std::chrono::milliseconds interval_;
+
+    std::mutex sync_mtx_;
+    std::condition_variable sync_cv_;
+    bool stopping_ = false;
+    std::thread sync_thread_;
+
+    [[noreturn]] void fail(const std::string& what) {
+        std::string message = what + ": " + std::strerror(errno);
+        unmap();
+        throw std::runtime_error(message);
+    }
+
+    void unmap() {
+        if (mapping_) munmap(mapping_, FILE_SIZE);
+        if (fd_ >= 0) close(fd_);
+        mapping_ = nullptr;
+        fd_ = -1;
+    }
+
+    void open_file(const std::string& path) {
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd_ < 0) fail("cannot open " + path);
+        if (flock(fd_, LOCK_EX | LOCK_NB) != 0) fail("register bank file already in use " + path);
+
+        struct stat st;
+        if (fstat(fd_, &st) != 0) fail("cannot stat " + path);
+        created_ = st.st_size == 0;
+        if (created_ && ftruncate(fd_, FILE_SIZE) != 0) fail("cannot size " + path);
+        if (!created_ && static_cast<size_t>(st.st_size) != FILE_SIZE) {
+            errno = EINVAL;
+            fail("register bank file size mismatch " + path);
+        }
+
+        void* mapping = mmap(nullptr, FILE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (mapping == MAP_FAILED) fail("cannot map " + path);
+        mapping_ = static_cast<std::uint8_t*>(mapping);
+
+        auto* header = reinterpret_cast<MappedBankHeader*>(mapping_);
+        if (created_) {
+            // ftruncate zero filled the tables.
+            std::memcpy(header->magic, MappedBankHeader::MAGIC, sizeof(header->magic));
+            header->version = MappedBankHeader::VERSION;
+            header->header_size = LAYOUT_OFFSET;
+            header->layout_size = sizeof(RegisterBankLayout);
+            if (msync(mapping_, LAYOUT_OFFSET, MS_SYNC) != 0) fail("cannot sync " + path);
+        }
+        else if (std::memcmp(header->magic, MappedBankHeader::MAGIC, sizeof(header->magic)) != 0
+            || header->version != MappedBankHeader::VERSION
+            || header->header_size != LAYOUT_OFFSET
+            || header->layout_size != sizeof(RegisterBankLayout)) {
+            errno = EINVAL;
+            fail("incompatible register bank file " + path);
+        }
+
+        auto* layout = reinterpret_cast<RegisterBankLayout*>(mapping_ + LAYOUT_OFFSET);
+        layout->coils.sequence = 0;
+        layout->discrete_inputs.sequence = 0;
+        layout->holding_registers.sequence = 0;
+        layout->input_registers.sequence = 0;
+        attach(layout);
+    }
+
+    // msync of the pages covering [begin, begin + size).
+    void sync_range(const void* begin, size_t size) {
+        constexpr std::uintptr_t PAGE = 4096;
+        auto first = reinterpret_cast<std::uintptr_t>(begin) & ~(PAGE - 1);
+        auto last = reinterpret_cast<std::uintptr_t>(begin) + size;
+        msync(reinterpret_cast<void*>(first), last - first, MS_SYNC);
+    }
+
+    void sync_registers(db::DbType type, std::uint16_t start, size_t count) {
+        if (policy_ != SyncPolicy::EveryWrite) return;
+        auto& table = (type == db::DbType::REGISTER) ? layout()->holding_registers : layout()->input_registers;
+        sync_range(&table.values[start], count * sizeof(std::uint16_t));
+    }
+
+    void sync_bits(db::DbType type, std::uint16_t start, size_t count) {
+        if (policy_ != SyncPolicy::EveryWrite) return;
+        auto& table = (type == db::DbType::BITS) ? layout()->coils : layout()->discrete_inputs;
+        size_t first = start / bits::WORD_BITS;
+        size_t last = (start + count - 1) / bits::WORD_BITS;
+        sync_range(&table.values[first], (last - first + 1) * sizeof(std::uint64_t));
+    }
+
+    void sync_loop() {
+        std::unique_lock<std::mutex> lock(sync_mtx_);
+        while (!sync_cv_.wait_for(lock, interval_, [this] { return stopping_; })) {
+            sync();
+        }
+    }
+
+public:
+    /**
+     * @param path file holding the bank, created when missing
+     * @param policy when the mapping is flushed to the file
+     * @param interval flush interval of SyncPolicy::Periodic
+     */
+    explicit MappedRegisterBank(const std::string& path, SyncPolicy policy = SyncPolicy::None,
+        std::chrono::milliseconds interval = std::chrono::milliseconds(1000))
+        : RegisterBank(nullptr), policy_(policy), interval_(interval) {
+        open_file(path);
+        if (policy_ == SyncPolicy::Periodic) {
+            sync_thread_ = std::thread([this] { sync_loop(); });
+        }
+    }
+
+    MappedRegisterBank(const MappedRegisterBank&) = delete;
+    MappedRegisterBank& operator=(const MappedRegisterBank&) = delete;
+
+    ~MappedRegisterBank() override {
+        if (sync_thread_.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(sync_mtx_);
+                stopping_ = true;
+            }
+            sync_cv_.notify_one();
+            sync_thread_.join();
+        }
+        if (policy_ != SyncPolicy::None) sync();
+        unmap();
+    }
+
+    /**
+     * @brief Whether the file was created by this bank (false when existing state was reopened)
+     */
+    bool created() const {
+        return created_;
+    }
+
+    SyncPolicy policy() const {
+        return policy_;
+    }
+
+    /**
+     * @brief Flush the whole mapping to the file
+     */
+    void sync() {
+        if (mapping_) msync(mapping_, FILE_SIZE, MS_SYNC);
+    }
+
+    bool db_create(std::uint16_t values) override {
+        RegisterBank::db_create(values);
+        if (policy_ == SyncPolicy::EveryWrite) sync();
+        return true;
+    }
+
+    bool db_update(db::DbType type, std::uint16_t id, std::variant<std::uint8_t, std::uint16_t> value) override {
+        RegisterBank::db_update(type, id, value);
+        if (is_bit_table(type)) sync_bits(type, id, 1);
+        else sync_registers(type, id, 1);
+        return true;
+    }
+
+    bool db_write_range(db::DbType type, std::uint16_t start, std::span<const std::uint16_t> values) override {
+        if (!RegisterBank::db_write_range(type, start, values)) return false;
+        if (!values.empty()) sync_registers(type, start, values.size());
+        return true;
+    }
+
+    bool db_write_bits(db::DbType type, std::uint16_t start, std::uint16_t count, std::span<const std::uint8_t> packed) override {
+        if (!RegisterBank::db_write_bits(type, start, count, packed)) return false;
+        if (count > 0) sync_bits(type, start, count);
+        return true;
+    }
+};
+
+} // namespace db
@@ -0,0 +1,190 @@
+#pragma once
+
+#include "az_modbus_transport_awaitable.hpp"
+#include "az_modbus_protocol.hpp"
+#include "az_modbus_pipeline.hpp"
+#include <stdexcept>
+#include <memory>
+
+namespace modbus {
+
+/**
+ * @brief Coroutine-native Modbus client
+ *
+ * Every call returns an asio::awaitable and runs on the channel executor, no
+ * thread is blocked while waiting for the server. Many clients (one per device
+ * session) can be driven from a single ModbusContext thread, and several
+ * coroutines may share one client: up to max_in_flight of their requests are
+ * pipelined on the connection.
+ */
+class AsyncModbusClient {
+private:
+    std::shared_ptr<IModbusChannel> transport_;
+    std::shared_ptr<TransactionPipeline> pipeline_;
+
+    awaitable<std::variant<std::vector<uint8_t>, std::vector<uint16_t>>> co_read_data(
+        std::uint8_t unit_id,
+        std::uint16_t start_address,
+        std::uint16_t quantity,
+        modbus::FunctionCode function_code) {
+
+        // Reads over the protocol limit are split and the chunks pipelined up to max_in_flight.
+        if (quantity > modbus::max_read_quantity(function_code)) {
+            auto requests = modbus::create_read_requests(unit_id, start_address, quantity, function_code);
+            auto responses = co_await pipeline_->co_transact_all(requests);
+            co_return modbus::decode_read_responses(requests, responses, function_code);
+        }
+
+        auto response = co_await pipeline_->co_transact(
+            modbus::create_read_adu(0, unit_id, start_address, quantity, function_code));
+
+        modbus::MbapHeaderView header(response);
+        if (header.unit_id() != unit_id) throw std::runtime_error("Invalid UNIT_ID");
+
+        co_return modbus::decode_read_data_response(header.pdu(), quantity, function_code);
+    }
+
+    awaitable<modbus::PackedBits> co_read_packed_bits(
+        std::uint8_t unit_id,
+        std::uint16_t start_address,
+        std::uint16_t quantity,
+        modbus::FunctionCode function_code) {
+
+        if (quantity > modbus::MAX_READ_BITS) {
+            auto requests = modbus::create_read_requests(unit_id, start_address, quantity, function_code);
+            auto responses = co_await pipeline_->co_transact_all(requests);
+            co_return modbus::decode_read_packed_responses(requests, responses);
+        }
+
+        auto response = co_await pipeline_->co_transact(
+            modbus::create_read_adu(0, unit_id, start_address, quantity, function_code));
+
+        modbus::MbapHeaderView header(response);
+        if (header.unit_id() != unit_id) throw std::runtime_error("Invalid UNIT_ID");
+
+        co_return modbus::decode_read_coils_packed(header.pdu(), quantity);
+    }
+
+    awaitable<void> co_write_data(std::uint8_t unit_id, std::uint16_t address, std::uint16_t value, modbus::FunctionCode function_code)
+    {
+        auto response = co_await pipeline_->co_transact(
+            modbus::create_write_adu(0, unit_id, address, value, function_code));
+
+        modbus::MbapHeaderView header(response);
+        if (header.unit_id() != unit_id) throw std::runtime_error("Invalid UNIT_ID");
+
+        modbus::check_write_response(header.pdu(), address, value);
+    }
+
+    template <typename T>
+    awaitable<void> co_write_multiple(std::uint8_t unit_id, std::uint16_t start_address, std::span<const T> values)
+    {
+        auto requests = modbus::create_write_multiple_requests(unit_id, start_address, values);
+        auto responses = co_await pipeline_->co_transact_all(requests);
+
+        for (size_t i = 0; i < requests.size(); ++i) {
+            modbus::PduView request(modbus::MbapHeaderView(requests[i]).pdu());
+            modbus::MbapHeaderView header(responses[i]);
+            if (header.unit_id() != unit_id) throw std::runtime_error("Invalid UNIT_ID");
+
+            modbus::check_write_multiple_response(header.pdu(), request.function_code(), request.start_addr(), request.number());
+        }
+    }
+
+public:
+    AsyncModbusClient(std::unique_ptr<IModbusChannel> transport, size_t max_in_flight = 1)
+        : transport_(std::move(transport)),
+          pipeline_(std::make_shared<TransactionPipeline>(transport_, max_in_flight)) {}
+
+    asio::any_io_executor get_executor() const {
+        return pipeline_->get_executor();
+    }
+
+    awaitable<void> co_connect(const modbus::Ipv4& host, const modbus::Port& port) {
+        co_await transport_->co_connect(host.value, port.value);
+    }
+
+    void close() {
+        transport_->close();
+    }
+
+    // FC 0x01: Read Coils
+    awaitable<std::vector<uint8_t>> co_read_coil(std::uint8_t unit_id, std::uint16_t start_address, std::uint16_t quantity)
+    {
+        co_return std::get<std::vector<uint8_t>>(co_await co_read_data(unit_id, start_address, quantity, modbus::FunctionCode::ReadCoils));
+    }
+
+    // FC 0x02: Read Discrete Inputs
+    awaitable<std::vector<uint8_t>> co_read_discrete_input(std::uint8_t unit_id, std::uint16_t start_address, std::uint16_t quantity)
+    {
+        co_return std::get<std::vector<uint8_t>>(co_await co_read_data(unit_id, start_address, quantity, modbus::FunctionCode::ReadDiscreteInputs));
+    }
+
+    // FC 0x01: Read Coils, bits kept in the Modbus packed layout
+    awaitable<modbus::PackedBits> co_read_coil_packed(std::uint8_t unit_id, std::uint16_t start_address, std::uint16_t quantity)
+    {
+        co_return co_await co_read_packed_bits(unit_id, start_address, quantity, modbus::FunctionCode::ReadCoils);
+    }
+
+    // FC 0x02: Read Discrete Inputs, bits kept in the Modbus packed layout
+    awaitable<modbus::PackedBits> co_read_discrete_input_packed(std::uint8_t unit_id, std::uint16_t start_address, std::uint16_t quantity)
+    {
+        co_return co_await co_read_packed_bits(unit_id, start_address, quantity, modbus::FunctionCode::ReadDiscreteInputs);
+    }
+
+    // FC 0x03: Holding Registers
+    awaitable<std::vector<uint16_t>> co_read_holding_registers(std::uint8_t unit_id, std::uint16_t start_address, std::uint16_t quantity)
+    {
+        co_return std::get<std::vector<uint16_t>>(co_await co_read_data(unit_id, start_address, quantity, modbus::FunctionCode::HoldingRegisters));
+    }
+
+    // FC 0x04: Input Registers
+    awaitable<std::vector<uint16_t>> co_read_input_registers(std::uint8_t unit_id, std::uint16_t start_address, std::uint16_t quantity)
+    {
+        co_return std::get<std::vector<uint16_t>>(co_await co_read_data(unit_id, start_address, quantity, modbus::FunctionCode::InputRegisters));
+    }
+
+    // FC 0x05: Write Single Coil
+    awaitable<void> co_write_single_coil(std::uint8_t unit_id, std::uint16_t address, std::uint16_t value)
+    {
+        co_await co_write_data(unit_id, address, value, modbus::FunctionCode::WriteSingleCoil);
+    }
+
+    // FC 0x06: Write Holding Register
+    awaitable<void> co_write_single_register(std::uint8_t unit_id, std::uint16_t address, std::uint16_t value)
+    {
+        co_await co_write_data(unit_id, address, value, modbus::FunctionCode::WriteSingleRegister);
+    }
+
+    // FC 0x0F: Write Multiple Coils, split at MAX_WRITE_BITS and pipelined up to max_in_flight
+    awaitable<void> co_write_multiple_coils(std::uint8_t unit_id, std::uint16_t start_address, std::span<const std::uint8_t> values)
+    {
+        co_await co_write_multiple(unit_id, start_address, values);
+    }
+
+    // FC 0x10: Write Multiple Registers, split at MAX_WRITE_REGISTERS and pipelined up to max_in_flight
+    awaitable<void> co_write_multiple_registers(std::uint8_t unit_id, std::uint16_t start_address, std::span<const std::uint16_t> values)
+    {
+        co_await co_write_multiple(unit_id, start_address, values);
+    }
+
+    // FC 0x17: Read/Write Multiple Registers, the write is applied before the read
+    awaitable<std::vector<uint16_t>> co_read_write_registers(
+        std::uint8_t unit_id,
+        std::uint16_t read_address,
+        std::uint16_t read_quantity,
+        std::uint16_t write_address,
+        std::span<const std::uint16_t> values)
+    {
+        auto response = co_await pipeline_->co_transact(
+            modbus::create_read_write_registers_adu(0, unit_id, read_address, read_quantity, write_address, values));
+
+        modbus::MbapHeaderView header(response);
+        if (header.unit_id() != unit_id) throw std::runtime_error("Invalid UNIT_ID");
+
+        co_return std::get<std::vector<uint16_t>>(
+            modbus::decode_read_data_response(header.pdu(), read_quantity, modbus::FunctionCode::ReadWriteMultipleRegisters));
+    }
+};
+
+} // namespace modbus
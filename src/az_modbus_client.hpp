@@ -2,6 +2,9 @@
 
 #include "az_modbus_transport_awaitable.hpp"
 #include "az_modbus_protocol.hpp"
+#include "az_modbus_frame_parser.hpp"
+#include "az_modbus_pipeline.hpp"
+#include "az_poll_planner.hpp"
 #include "az_helper.hpp"
 #include <stdexcept>
 #include <memory>
@@ -10,119 +13,238 @@ namespace modbus {
 
 class ModbusClient {
 private:
-    std::unique_ptr<IModbusChannel> transport_;
+    std::shared_ptr<IModbusChannel> transport_;
+    std::shared_ptr<TransactionPipeline> pipeline_;
     std::uint16_t next_tid_ = 0;
+    modbus::FrameParser parser_;
 
-    std::variant<std::vector<uint8_t>, std::vector<uint16_t>> read_data(
-        std::uint8_t unit_id,
-        std::uint16_t start_address,
-        std::uint16_t quantity,
-        modbus::FunctionCode function_code) {
+    using ReadResult = std::variant<std::vector<uint8_t>, std::vector<uint16_t>>;
 
-        std::uint16_t tid = next_tid_++;
-        auto request = modbus::create_read_adu(tid, unit_id, start_address, quantity, function_code);
+    // Reads until one complete response ADU is buffered - Blocking operation
+    std::span<const std::uint8_t> read_frame() {
+        while (true) {
+            if (auto frame = parser_.next_frame()) {
+                return *frame;
+            }
+            auto received = transport_->read_some(parser_.prepare()).get();
+            parser_.commit(received);
+        }
+    }
 
+    // Stop-and-wait exchange, the returned frame lives in the parser buffer - Blocking operation
+    std::span<const std::uint8_t> exchange(const std::vector<std::uint8_t>& request) {
         helper::print_hex_buffer(request, ">>>> request: ");
 
         // Send the request message - Blocking operation
         transport_->write(request).get();
 
-        auto header_buffer = transport_->read(MBAP_HEADER_SIZE).get();
-        auto header = modbus::decode_header(header_buffer);
+        auto frame = read_frame();
+        modbus::MbapHeaderView header(frame);
 
-        if (header.transaction_id != tid) {
+        if (header.transaction_id() != from_big_endian(request[0], request[1])) {
             throw std::runtime_error("TID de resposta incorreto.");
         }
-        helper::print_hex_buffer(header_buffer, "<<<< header_buffer: ");
+        helper::print_hex_buffer(frame, "<<<< frame: ");
+        return frame;
+    }
+
+    std::shared_ptr<TransactionPipeline> require_pipeline() {
+        if (!pipeline_) {
+            throw std::runtime_error("Pipelining not enabled");
+        }
+        return pipeline_;
+    }
+
+    // Logs the response header and returns its PDU, throws on exception responses.
+    static std::span<const std::uint8_t> read_response_pdu(std::span<const std::uint8_t> frame) {
+        modbus::MbapHeaderView header(frame);
 
         std::cout
             << "unit_id:"
-            << static_cast<int>(header.unit_id)
+            << static_cast<int>(header.unit_id())
             << " transaction_id:"
-            << header.transaction_id
+            << header.transaction_id()
             << " protocol_id:"
-            << header.protocol_id
+            << header.protocol_id()
             << " length:"
-            << header.length
+            << header.length()
             << "\n";
 
-        size_t pdu_size = header.length - 1;
-        auto pdu_data = transport_->read(pdu_size).get();
+        auto pdu_data = header.pdu();
 
         modbus::check_exception(pdu_data);
 
         helper::print_hex_buffer(pdu_data, "<<<< pdu_data: ");
+        return pdu_data;
+    }
 
-        switch (function_code) {
-            case modbus::FunctionCode::ReadCoils:
-            case modbus::FunctionCode::ReadDiscreteInputs:
-            {
-                auto data_response = modbus::decode_read_coils_response(pdu_data, quantity);
-                return data_response;
-            }
-            case modbus::FunctionCode::HoldingRegisters:
-            case modbus::FunctionCode::InputRegisters:
-            {
-                auto data_response = modbus::decode_read_register_response(pdu_data, quantity);
-                return data_response;
-            }
-            default:
-                throw std::runtime_error("Function Code " + std::to_string(function_code) + " nnot supported");
+    static ReadResult decode_read_data(
+        std::span<const std::uint8_t> frame,
+        std::uint16_t quantity,
+        modbus::FunctionCode function_code) {
+        return modbus::decode_read_data_response(read_response_pdu(frame), quantity, function_code);
+    }
+
+    // Sends a request and hands the response frame to decode - Blocking operation
+    template <typename Decode>
+    auto transact_with(std::vector<std::uint8_t> request, Decode decode) {
+        if (pipeline_) {
+            auto response = pipeline_->transact(std::move(request)).get();
+            return decode(std::span<const std::uint8_t>(response));
         }
+
+        auto tid_bytes = to_big_endian(next_tid_++);
+        std::copy(tid_bytes.begin(), tid_bytes.end(), request.begin());
+        return decode(exchange(request));
+    }
+
+    ReadResult read_data(
+        std::uint8_t unit_id,
+        std::uint16_t start_address,
+        std::uint16_t quantity,
+        modbus::FunctionCode function_code) {
+
+        // Reads over the protocol limit are split, sent back-to-back when pipelining is enabled and joined.
+        if (quantity > modbus::max_read_quantity(function_code)) {
+            auto requests = modbus::create_read_requests(unit_id, start_address, quantity, function_code);
+            return modbus::decode_read_responses(requests, transact_all(requests), function_code);
+        }
+
+        auto request = modbus::create_read_adu(0, unit_id, start_address, quantity, function_code);
+        return transact_with(std::move(request), [&](std::span<const std::uint8_t> frame) {
+            return decode_read_data(frame, quantity, function_code);
+        });
+    }
+
+    modbus::PackedBits read_packed_bits(
+        std::uint8_t unit_id,
+        std::uint16_t start_address,
+        std::uint16_t quantity,
+        modbus::FunctionCode function_code) {
+
+        if (quantity > modbus::MAX_READ_BITS) {
+            auto requests = modbus::create_read_requests(unit_id, start_address, quantity, function_code);
+            return modbus::decode_read_packed_responses(requests, transact_all(requests));
+        }
+
+        auto request = modbus::create_read_adu(0, unit_id, start_address, quantity, function_code);
+        return transact_with(std::move(request), [&](std::span<const std::uint8_t> frame) {
+            return modbus::decode_read_coils_packed(read_response_pdu(frame), quantity);
+        });
     }
 
     void write_data(std::uint8_t unit_id, std::uint16_t address, std::uint16_t value, modbus::FunctionCode function_code)
     {
+        if (pipeline_) {
+            auto response = pipeline_->transact(modbus::create_write_adu(0, unit_id, address, value, function_code)).get();
+            modbus::MbapHeaderView header(response);
+            if (header.unit_id() != unit_id) throw std::runtime_error("Invalid UNIT_ID");
+
+            modbus::check_write_response(header.pdu(), address, value);
+            return;
+        }
+
         // Build the message
         std::uint16_t tid = next_tid_++;
         auto request = modbus::create_write_adu(tid, unit_id, address, value, function_code);
+        modbus::MbapHeaderView header(exchange(request));
+        if (header.unit_id() != unit_id) throw std::runtime_error("Invalid UNIT_ID");
 
-        helper::print_hex_buffer(request, ">>>> request: ");
-
-        // Send the request message - Blocking operation
-        transport_->write(request).get();
-
-        // Header processing - Blocking operation
-        auto header_buffer = transport_->read(MBAP_HEADER_SIZE).get();
+        modbus::check_write_response(header.pdu(), address, value);
+    }
 
-        helper::print_hex_buffer(header_buffer, "<<<< header_buffer: ");
+    // Sends every request and returns copies of the responses, pipelined when enabled - Blocking operation
+    std::vector<std::vector<std::uint8_t>> transact_all(std::vector<std::vector<std::uint8_t>> requests) {
+        if (pipeline_) {
+            return pipeline_->transact_all(std::move(requests)).get();
+        }
 
-        auto header = modbus::decode_header(header_buffer);
+        std::vector<std::vector<std::uint8_t>> responses;
+        for (auto& request : requests) {
+            auto tid_bytes = to_big_endian(next_tid_++);
+            std::copy(tid_bytes.begin(), tid_bytes.end(), request.begin());
+            auto frame = exchange(request);
+            responses.emplace_back(frame.begin(), frame.end());
+        }
+        return responses;
+    }
 
-        // PDU processing - Blocking operation
-        size_t pdu_size = header.length - 1;
-        auto pdu_data = transport_->read(pdu_size).get();
+    // Checks every Write Multiple response against its request.
+    static void check_write_multiple_data(
+        const std::vector<std::vector<std::uint8_t>>& requests,
+        const std::vector<std::vector<std::uint8_t>>& responses,
+        std::uint8_t unit_id) {
 
-        helper::print_hex_buffer(pdu_data, "<<<< pdu_data: ");
+        for (size_t i = 0; i < requests.size(); ++i) {
+            modbus::PduView request(modbus::MbapHeaderView(requests[i]).pdu());
+            modbus::MbapHeaderView header(responses[i]);
+            if (header.unit_id() != unit_id) throw std::runtime_error("Invalid UNIT_ID");
 
-        auto data = decode_request(pdu_data);
+            helper::print_hex_buffer(header.pdu(), "<<<< pdu_data: ");
+            modbus::check_write_multiple_response(header.pdu(), request.function_code(), request.start_addr(), request.number());
+        }
+    }
 
-        if (std::holds_alternative<modbus::RequestData>(data)) {
+    template <typename T>
+    void write_multiple(std::uint8_t unit_id, std::uint16_t start_address, std::span<const T> values) {
+        auto requests = modbus::create_write_multiple_requests(unit_id, start_address, values);
+        auto responses = transact_all(requests);
+        check_write_multiple_data(requests, responses, unit_id);
+    }
 
-            auto response = std::get<modbus::RequestData>(data);
+    template <typename T>
+    std::future<void> async_write_multiple(std::uint8_t unit_id, std::uint16_t start_address, std::span<const T> values) {
+        auto pipeline = require_pipeline();
+        auto requests = modbus::create_write_multiple_requests(unit_id, start_address, values);
+        return co_spawn(pipeline->get_executor(),
+            [pipeline, requests = std::move(requests), unit_id]() mutable -> awaitable<void> {
+                auto responses = co_await pipeline->co_transact_all(requests);
+                check_write_multiple_data(requests, responses, unit_id);
+            },
+            asio::use_future);
+    }
 
-            std::cout
-            << "PDU FC=0x"
-            << std::hex
-            << static_cast<int>(response.func_code)
-            << std::dec
-            << " Start Addr:"
-            << response.start_addr
-            << " Value:"
-            << response.value
-            << "\n";
+    template <typename Result>
+    std::future<Result> async_read_data(
+        std::uint8_t unit_id,
+        std::uint16_t start_address,
+        std::uint16_t quantity,
+        modbus::FunctionCode function_code) {
 
-            modbus::check_exception(pdu_data);
+        auto pipeline = require_pipeline();
+        auto requests = modbus::create_read_requests(unit_id, start_address, quantity, function_code);
+        return co_spawn(pipeline->get_executor(),
+            [pipeline, requests = std::move(requests), quantity, function_code]() mutable -> awaitable<Result> {
+                ReadResult data;
+                if (requests.size() == 1) {
+                    auto response = co_await pipeline->co_transact(std::move(requests.front()));
+                    data = decode_read_data(response, quantity, function_code);
+                } else {
+                    auto responses = co_await pipeline->co_transact_all(requests);
+                    data = modbus::decode_read_responses(requests, responses, function_code);
+                }
+                if constexpr (std::is_same_v<Result, ReadResult>) {
+                    co_return data;
+                } else {
+                    co_return std::get<Result>(std::move(data));
+                }
+            },
+            asio::use_future);
+    }
 
-            if(header.transaction_id != tid) throw std::runtime_error("Invalid TID");
-            if(header.unit_id != unit_id) throw std::runtime_error("Invalid UNIT_ID");
-            if(response.start_addr != address) throw std::runtime_error("Invalid START_ADDR");
-            if(response.value != value) throw std::runtime_error("Invalid VALUE");
-        }
-        else {
-            auto exception = std::get<modbus::Exceptiondata>(data);
-            std::cerr << "[SERVER] Exception response: [" << static_cast<int>(exception.code) << "] " << exception.name << std::endl;
-        }
+    std::future<void> async_write_data(std::uint8_t unit_id, std::uint16_t address, std::uint16_t value, modbus::FunctionCode function_code)
+    {
+        auto pipeline = require_pipeline();
+        auto request = modbus::create_write_adu(0, unit_id, address, value, function_code);
+        return co_spawn(pipeline->get_executor(),
+            [pipeline, request = std::move(request), unit_id, address, value]() mutable -> awaitable<void> {
+                auto response = co_await pipeline->co_transact(std::move(request));
+                modbus::MbapHeaderView header(response);
+                if (header.unit_id() != unit_id) throw std::runtime_error("Invalid UNIT_ID");
+
+                modbus::check_write_response(header.pdu(), address, value);
+            },
+            asio::use_future);
     }
 
 public:
@@ -137,6 +259,55 @@ public:
         transport_->close();
     }
 
+    /**
+     * @brief Enable pipelined mode
+     *
+     * Keeps up to max_in_flight requests outstanding on the connection. The
+     * blocking API keeps working, the async_ API returns futures so several
+     * requests can be issued before waiting for their responses.
+     *
+     * @param max_in_flight maximum number of outstanding requests
+     */
+    void enable_pipelining(size_t max_in_flight) {
+        pipeline_ = std::make_shared<TransactionPipeline>(transport_, max_in_flight);
+    }
+
+    bool pipelining_enabled() const {
+        return pipeline_ != nullptr;
+    }
+
+    /**
+     * @brief Read every request of a poll plan and scatter the values to its tags
+     *
+     * With pipelining enabled all the requests are issued before waiting for the
+     * first response, otherwise they are sent one after the other.
+     *
+     * @param unit_id device unit number
+     * @param plan plan built by PollPlanner
+     * @return values of every tag, in plan.tags order
+     */
+    std::vector<modbus::PollValue> poll(std::uint8_t unit_id, const modbus::PollPlan& plan)
+    {
+        std::vector<modbus::PollValue> values(plan.tags.size());
+
+        if (pipeline_) {
+            std::vector<std::future<ReadResult>> responses;
+            for (const auto& request : plan.requests) {
+                responses.push_back(async_read_data<ReadResult>(unit_id, request.address, request.quantity, request.function_code));
+            }
+            for (size_t i = 0; i < responses.size(); ++i) {
+                modbus::PollPlanner::scatter(plan, i, responses[i].get(), values);
+            }
+            return values;
+        }
+
+        for (size_t i = 0; i < plan.requests.size(); ++i) {
+            const auto& request = plan.requests[i];
+            modbus::PollPlanner::scatter(plan, i, read_data(unit_id, request.address, request.quantity, request.function_code), values);
+        }
+        return values;
+    }
+
     // FC 0x01: Read Coils
     std::vector<uint8_t> read_coil(std::uint8_t unit_id, std::uint16_t start_address, std::uint16_t quantity)
     {
@@ -149,6 +320,18 @@ public:
         return std::get<std::vector<uint8_t>>(read_data(unit_id, start_address, quantity, modbus::FunctionCode::ReadDiscreteInputs));
     }
 
+    // FC 0x01: Read Coils, bits kept in the Modbus packed layout
+    modbus::PackedBits read_coil_packed(std::uint8_t unit_id, std::uint16_t start_address, std::uint16_t quantity)
+    {
+        return read_packed_bits(unit_id, start_address, quantity, modbus::FunctionCode::ReadCoils);
+    }
+
+    // FC 0x02: Read Discrete Inputs, bits kept in the Modbus packed layout
+    modbus::PackedBits read_discrete_input_packed(std::uint8_t unit_id, std::uint16_t start_address, std::uint16_t quantity)
+    {
+        return read_packed_bits(unit_id, start_address, quantity, modbus::FunctionCode::ReadDiscreteInputs);
+    }
+
     // FC 0x03: Holding Registers
     std::vector<uint16_t> read_holding_registers(std::uint8_t unit_id, std::uint16_t start_address, std::uint16_t quantity)
     {
@@ -172,6 +355,110 @@ public:
     {
         write_data(unit_id, address, value, modbus::FunctionCode::WriteSingleRegister);
     }
+
+    /**
+     * @brief FC 0x0F: Write Multiple Coils
+     *
+     * Writes longer than MAX_WRITE_BITS are split into several requests,
+     * pipelined when pipelining is enabled.
+     *
+     * @param unit_id device unit number
+     * @param start_address first coil
+     * @param values one byte per coil (non zero = ON)
+     */
+    void write_multiple_coils(std::uint8_t unit_id, std::uint16_t start_address, std::span<const std::uint8_t> values)
+    {
+        write_multiple(unit_id, start_address, values);
+    }
+
+    /**
+     * @brief FC 0x10: Write Multiple Registers
+     *
+     * Writes longer than MAX_WRITE_REGISTERS are split into several requests,
+     * pipelined when pipelining is enabled.
+     *
+     * @param unit_id device unit number
+     * @param start_address first register
+     * @param values register values
+     */
+    void write_multiple_registers(std::uint8_t unit_id, std::uint16_t start_address, std::span<const std::uint16_t> values)
+    {
+        write_multiple(unit_id, start_address, values);
+    }
+
+    /**
+     * @brief FC 0x17: Read/Write Multiple Registers
+     *
+     * The server applies the write before the read, both in one round trip.
+     *
+     * @param unit_id device unit number
+     * @param read_address first register to read
+     * @param read_quantity registers to read, at most MAX_READ_REGISTERS
+     * @param write_address first register to write
+     * @param values registers to write, at most MAX_READ_WRITE_REGISTERS
+     * @return registers read
+     */
+    std::vector<uint16_t> read_write_registers(
+        std::uint8_t unit_id,
+        std::uint16_t read_address,
+        std::uint16_t read_quantity,
+        std::uint16_t write_address,
+        std::span<const std::uint16_t> values)
+    {
+        auto request = modbus::create_read_write_registers_adu(0, unit_id, read_address, read_quantity, write_address, values);
+        return transact_with(std::move(request), [&](std::span<const std::uint8_t> frame) {
+            if (modbus::MbapHeaderView(frame).unit_id() != unit_id) throw std::runtime_error("Invalid UNIT_ID");
+            return std::get<std::vector<uint16_t>>(decode_read_data(frame, read_quantity, modbus::FunctionCode::ReadWriteMultipleRegisters));
+        });
+    }
+
+    // Pipelined FC 0x01: Read Coils
+    std::future<std::vector<uint8_t>> async_read_coil(std::uint8_t unit_id, std::uint16_t start_address, std::uint16_t quantity)
+    {
+        return async_read_data<std::vector<uint8_t>>(unit_id, start_address, quantity, modbus::FunctionCode::ReadCoils);
+    }
+
+    // Pipelined FC 0x02: Read Discrete Inputs
+    std::future<std::vector<uint8_t>> async_read_discrete_input(std::uint8_t unit_id, std::uint16_t start_address, std::uint16_t quantity)
+    {
+        return async_read_data<std::vector<uint8_t>>(unit_id, start_address, quantity, modbus::FunctionCode::ReadDiscreteInputs);
+    }
+
+    // Pipelined FC 0x03: Holding Registers
+    std::future<std::vector<uint16_t>> async_read_holding_registers(std::uint8_t unit_id, std::uint16_t start_address, std::uint16_t quantity)
+    {
+        return async_read_data<std::vector<uint16_t>>(unit_id, start_address, quantity, modbus::FunctionCode::HoldingRegisters);
+    }
+
+    // Pipelined FC 0x04: Input Registers
+    std::future<std::vector<uint16_t>> async_read_input_registers(std::uint8_t unit_id, std::uint16_t start_address, std::uint16_t quantity)
+    {
+        return async_read_data<std::vector<uint16_t>>(unit_id, start_address, quantity, modbus::FunctionCode::InputRegisters);
+    }
+
+    // Pipelined FC 0x05: Write Single Coil
+    std::future<void> async_write_single_coil(std::uint8_t unit_id, std::uint16_t address, std::uint16_t value)
+    {
+        return async_write_data(unit_id, address, value, modbus::FunctionCode::WriteSingleCoil);
+    }
+
+    // Pipelined FC 0x06: Write Holding Register
+    std::future<void> async_write_single_register(std::uint8_t unit_id, std::uint16_t address, std::uint16_t value)
+    {
+        return async_write_data(unit_id, address, value, modbus::FunctionCode::WriteSingleRegister);
+    }
+
+    // Pipelined FC 0x0F: Write Multiple Coils
+    std::future<void> async_write_multiple_coils(std::uint8_t unit_id, std::uint16_t start_address, std::span<const std::uint8_t> values)
+    {
+        return async_write_multiple(unit_id, start_address, values);
+    }
+
+    // Pipelined FC 0x10: Write Multiple Registers
+    std::future<void> async_write_multiple_registers(std::uint8_t unit_id, std::uint16_t start_address, std::span<const std::uint16_t> values)
+    {
+        return async_write_multiple(unit_id, start_address, values);
+    }
 };
 
 } // namespace modbus
\ No newline at end of file
@@ -4,45 +4,109 @@
 #include <thread>
 #include <optional>
 #include <future>
+#include <atomic>
+#include <memory>
+#include <vector>
 
 namespace modbus {
 
 using asio::ip::tcp;
 
+/**
+ * @brief Pool of event loops, one io_context running on each worker thread
+ *
+ * Every connection is bound to one io_context, so its coroutines never run
+ * concurrently with themselves and need no strand. Different connections may
+ * run in parallel: anything they share (e.g. the ModbusServer database) must be
+ * thread safe when more than one thread is used.
+ */
 class ModbusContext {
 private:
-    asio::io_context io_context_;
-    std::optional<asio::executor_work_guard<asio::io_context::executor_type>> work_guard_;
-    std::thread io_thread_;
+    using WorkGuard = asio::executor_work_guard<asio::io_context::executor_type>;
+
+    std::vector<std::unique_ptr<asio::io_context>> io_contexts_;
+    std::vector<std::optional<WorkGuard>> work_guards_;
+    std::vector<std::thread> io_threads_;
+    std::atomic<size_t> next_{0};
+
+    // Wait for the I/O threads.
+    void join() {
+        for (auto& io_thread : io_threads_) {
+            if (io_thread.joinable()) {
+                io_thread.join();
+            }
+        }
+    }
 
 public:
-    ModbusContext() {
-        // Keep the io_context running.
-        work_guard_.emplace(io_context_.get_executor());
+    /**
+     * @param threads number of worker threads (and io_contexts), at least 1
+     */
+    explicit ModbusContext(size_t threads = 1) {
+        threads = std::max<size_t>(threads, 1);
+        for (size_t i = 0; i < threads; ++i) {
+            io_contexts_.push_back(std::make_unique<asio::io_context>(1));
 
-        // Starts the background thread to run the event loop.
-        io_thread_ = std::thread([this] {
-            io_context_.run();
-        });
+            // Keep the io_context running.
+            work_guards_.emplace_back(std::in_place, io_contexts_.back()->get_executor());
+        }
+
+        // Starts the background threads to run the event loops.
+        for (auto& io_context : io_contexts_) {
+            io_threads_.emplace_back([&io = *io_context] {
+                io.run();
+            });
+        }
     }
 
     ~ModbusContext() {
-        // Release the work_guard, allowing io_context::run() to finish.
-        work_guard_.reset();
+        // Release the work_guards, allowing io_context::run() to finish.
+        for (auto& work_guard : work_guards_) {
+            work_guard.reset();
+        }
+        join();
+    }
+
+    ModbusContext(const ModbusContext&) = delete;
+    ModbusContext& operator=(const ModbusContext&) = delete;
 
-        // Wait for the I/O thread.
-        if (io_thread_.joinable()) {
-            io_thread_.join();
+    /**
+     * @brief Stop every event loop, pending operations are abandoned, and wait for the I/O threads
+     *
+     * Needed before destruction while operations that never complete on their
+     * own (e.g. the server accept loops) are pending.
+     */
+    void stop() {
+        for (auto& io_context : io_contexts_) {
+            io_context->stop();
         }
+        join();
+    }
+
+    size_t size() const {
+        return io_contexts_.size();
     }
 
+    // Executor of the first io_context.
     asio::io_context::executor_type get_executor() {
-        return io_context_.get_executor();
+        return io_contexts_.front()->get_executor();
     }
 
+    // First io_context.
     asio::io_context& get_io_context() {
-        return io_context_;
+        return *io_contexts_.front();
+    }
+
+    asio::io_context& get_io_context(size_t index) {
+        return *io_contexts_.at(index);
+    }
+
+    /**
+     * @brief io_context for a new connection, handed out round-robin
+     */
+    asio::io_context& next_io_context() {
+        return *io_contexts_[next_.fetch_add(1, std::memory_order_relaxed) % io_contexts_.size()];
     }
 };
 
-} // namespace modbus
\ No newline at end of file
+} // namespace modbus
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "az_modbus_protocol.hpp"
+#include <cstring>
+#include <expected>
+#include <optional>
+#include <string>
+
+namespace modbus {
+
+/**
+ * @brief Resumable MBAP frame parser
+ *
+ * Accepts whatever bytes a single read_some returns and yields zero or more
+ * complete ADUs. Frames split across reads are kept until they are complete,
+ * coalesced frames are returned one by one.
+ *
+ * The receive buffer grows on demand and is compacted in place instead of
+ * wrapping, so every returned frame is contiguous. A frame span stays valid
+ * until the next call to prepare(), feed() or reset().
+ */
+class FrameParser {
+private:
+    std::vector<std::uint8_t> buffer_;
+    size_t head_ = 0; // First byte not consumed yet
+    size_t tail_ = 0; // End of the received bytes
+
+public:
+    explicit FrameParser(size_t initial_capacity = 4 * MAX_ADU_SIZE)
+        : buffer_(initial_capacity) {}
+
+    /**
+     * @brief Writable region for the next socket read
+     *
+     * @param min_size minimum number of bytes that must fit
+     * @return free space at the end of the buffer
+     */
+    std::span<std::uint8_t> prepare(size_t min_size = MAX_ADU_SIZE) {
+        if (buffer_.size() - tail_ < min_size) {
+            // Move the unread bytes to the front before growing.
+            if (head_ > 0) {
+                std::memmove(buffer_.data(), buffer_.data() + head_, tail_ - head_);
+                tail_ -= head_;
+                head_ = 0;
+            }
+            if (buffer_.size() - tail_ < min_size) {
+                buffer_.resize(std::max(buffer_.size() * 2, tail_ + min_size));
+            }
+        }
+        return std::span<std::uint8_t>(buffer_).subspan(tail_);
+    }
+
+    /**
+     * @brief Mark bytes written into the prepare() region as received
+     *
+     * @param bytes number of bytes received
+     */
+    void commit(size_t bytes) {
+        tail_ += std::min(bytes, buffer_.size() - tail_);
+    }
+
+    /**
+     * @brief Append received bytes
+     *
+     * @param bytes bytes received
+     */
+    void feed(std::span<const std::uint8_t> bytes) {
+        auto space = prepare(bytes.size());
+        std::copy(bytes.begin(), bytes.end(), space.begin());
+        commit(bytes.size());
+    }
+
+    /**
+     * @brief Extract the next complete ADU without throwing
+     *
+     * @return view over the ADU (MBAP header + PDU), empty when more bytes are needed,
+     *         or the reason the stream can not be split into frames any more
+     */
+    std::expected<std::optional<std::span<const std::uint8_t>>, DecodeError> try_next_frame() {
+        size_t available = tail_ - head_;
+        if (available < MBAP_HEADER_SIZE) {
+            return std::nullopt;
+        }
+
+        const std::uint8_t* data = buffer_.data() + head_;
+        if (from_big_endian(data[2], data[3]) != 0x0000) {
+            return std::unexpected(DecodeError::InvalidProtocolId);
+        }
+
+        // Length = Unit ID + PDU, the PDU holds at least FC + 1 byte.
+        std::uint16_t length = from_big_endian(data[4], data[5]);
+        if (length < 2 || length > MAX_ADU_SIZE - (MBAP_HEADER_SIZE - 1)) {
+            return std::unexpected(DecodeError::InvalidLength);
+        }
+
+        size_t frame_size = (MBAP_HEADER_SIZE - 1) + length;
+        if (available < frame_size) {
+            return std::nullopt;
+        }
+
+        std::span<const std::uint8_t> frame(data, frame_size);
+        head_ += frame_size;
+        return frame;
+    }
+
+    /**
+     * @brief Extract the next complete ADU
+     *
+     * @return view over the ADU (MBAP header + PDU), empty when more bytes are needed
+     */
+    std::optional<std::span<const std::uint8_t>> next_frame() {
+        auto frame = try_next_frame();
+        if (!frame) {
+            throw std::runtime_error(std::string(decode_error_name(frame.error())));
+        }
+        return *frame;
+    }
+
+    /**
+     * @brief Number of received bytes not yet returned as a frame
+     */
+    size_t buffered() const {
+        return tail_ - head_;
+    }
+
+    /**
+     * @brief Drop every buffered byte
+     */
+    void reset() {
+        head_ = 0;
+        tail_ = 0;
+    }
+};
+
+} // namespace modbus
@@ -0,0 +1,254 @@
+#pragma once
+
+#include "az_modbus_transport_awaitable.hpp"
+#include "az_modbus_protocol.hpp"
+#include "az_modbus_frame_parser.hpp"
+#include <asio/co_spawn.hpp>
+#include <asio/detached.hpp>
+#include <asio/redirect_error.hpp>
+#include <asio/steady_timer.hpp>
+#include <exception>
+#include <memory>
+#include <unordered_map>
+
+namespace modbus {
+
+/**
+ * @brief Keeps several transactions in flight on one connection
+ *
+ * Requests are written back-to-back and a background reader coroutine matches
+ * the responses to their requests by transaction ID, so replies may arrive in
+ * any order. Up to max_in_flight requests are outstanding at once, further
+ * submissions wait for a free slot.
+ *
+ * Every member runs on the channel executor: use the co_ API from a coroutine
+ * running there, or transact() from any other thread.
+ */
+class TransactionPipeline : public std::enable_shared_from_this<TransactionPipeline> {
+public:
+    struct Transaction {
+        std::uint16_t tid;
+        std::vector<std::uint8_t> response; // Full response ADU
+        std::exception_ptr error;
+        bool done = false;
+        asio::steady_timer signal;
+
+        Transaction(asio::any_io_executor executor, std::uint16_t transaction_id)
+            : tid(transaction_id), signal(executor, asio::steady_timer::time_point::max()) {}
+    };
+
+    using TransactionPtr = std::shared_ptr<Transaction>;
+
+private:
+    std::shared_ptr<IModbusChannel> channel_;
+    asio::any_io_executor executor_;
+    size_t max_in_flight_;
+    std::uint16_t next_tid_ = 0;
+    std::unordered_map<std::uint16_t, TransactionPtr> in_flight_;
+    std::vector<std::vector<std::uint8_t>> write_queue_;
+    std::vector<std::vector<std::uint8_t>> write_batch_; // Frames of the write in progress
+    bool writing_ = false;
+    bool reading_ = false;
+    asio::steady_timer slot_signal_;
+    modbus::FrameParser parser_;
+    std::exception_ptr failure_;
+
+    // Completes every outstanding transaction with the connection error.
+    void fail_all(std::exception_ptr error) {
+        failure_ = error;
+        for (auto& [tid, transaction] : in_flight_) {
+            transaction->error = error;
+            transaction->done = true;
+            transaction->signal.cancel();
+        }
+        in_flight_.clear();
+        slot_signal_.cancel();
+    }
+
+    // Reader curtain, runs while there are outstanding transactions.
+    awaitable<void> do_read_loop() {
+        try {
+            while (!in_flight_.empty()) {
+                auto received = co_await channel_->co_read_some(parser_.prepare());
+                parser_.commit(received);
+
+                while (auto frame = parser_.next_frame()) {
+                    modbus::MbapHeaderView header(*frame);
+                    auto it = in_flight_.find(header.transaction_id());
+                    if (it == in_flight_.end()) {
+                        // Late or unsolicited reply.
+                        continue;
+                    }
+                    auto transaction = std::move(it->second);
+                    in_flight_.erase(it);
+
+                    transaction->response.assign(frame->begin(), frame->end());
+                    transaction->done = true;
+                    transaction->signal.cancel();
+                    slot_signal_.cancel();
+                }
+            }
+        } catch (...) {
+            fail_all(std::current_exception());
+        }
+        reading_ = false;
+    }
+
+    // Writer curtain, the first caller drains the queue so frames never interleave.
+    awaitable<void> do_write_queue() {
+        try {
+            while (!write_queue_.empty()) {
+                // Everything queued so far goes out in one write.
+                write_batch_.swap(write_queue_);
+                co_await channel_->co_write_batch(write_batch_);
+                write_batch_.clear();
+            }
+        } catch (...) {
+            write_queue_.clear();
+            write_batch_.clear();
+            fail_all(std::current_exception());
+        }
+        writing_ = false;
+    }
+
+    std::uint16_t allocate_tid() {
+        while (in_flight_.contains(next_tid_)) {
+            next_tid_++;
+        }
+        return next_tid_++;
+    }
+
+public:
+    TransactionPipeline(std::shared_ptr<IModbusChannel> channel, size_t max_in_flight)
+        : channel_(std::move(channel)),
+          executor_(channel_->get_executor()),
+          max_in_flight_(std::max<size_t>(max_in_flight, 1)),
+          slot_signal_(executor_, asio::steady_timer::time_point::max()) {}
+
+    asio::any_io_executor get_executor() const {
+        return executor_;
+    }
+
+    size_t max_in_flight() const {
+        return max_in_flight_;
+    }
+
+    size_t in_flight() const {
+        return in_flight_.size();
+    }
+
+    /**
+     * @brief Send a request without waiting for its response
+     *
+     * Waits only while max_in_flight requests are outstanding. The transaction
+     * ID of the ADU is overwritten with the one allocated by the pipeline.
+     *
+     * @param adu request message buffer
+     * @return handle to wait on with co_result()
+     */
+    awaitable<TransactionPtr> co_submit(std::vector<std::uint8_t> adu) {
+        while (in_flight_.size() >= max_in_flight_ && !failure_) {
+            asio::error_code ec;
+            co_await slot_signal_.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+        }
+        if (failure_) {
+            std::rethrow_exception(failure_);
+        }
+
+        auto transaction = std::make_shared<Transaction>(executor_, allocate_tid());
+        auto tid_bytes = to_big_endian(transaction->tid);
+        std::copy(tid_bytes.begin(), tid_bytes.end(), adu.begin());
+        in_flight_.emplace(transaction->tid, transaction);
+
+        if (!reading_) {
+            reading_ = true;
+            co_spawn(executor_, [self = shared_from_this()]() { return self->do_read_loop(); }, asio::detached);
+        }
+
+        write_queue_.push_back(std::move(adu));
+        if (!writing_) {
+            writing_ = true;
+            co_spawn(executor_, [self = shared_from_this()]() { return self->do_write_queue(); }, asio::detached);
+        }
+        co_return transaction;
+    }
+
+    /**
+     * @brief Wait for the response of a submitted request
+     *
+     * @param transaction handle returned by co_submit()
+     * @return response message buffer (MBAP header + PDU)
+     */
+    awaitable<std::vector<std::uint8_t>> co_result(TransactionPtr transaction) {
+        while (!transaction->done) {
+            asio::error_code ec;
+            co_await transaction->signal.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+        }
+        if (transaction->error) {
+            std::rethrow_exception(transaction->error);
+        }
+        co_return std::move(transaction->response);
+    }
+
+    /**
+     * @brief Send a request and wait for its response
+     *
+     * @param adu request message buffer
+     * @return response message buffer (MBAP header + PDU)
+     */
+    awaitable<std::vector<std::uint8_t>> co_transact(std::vector<std::uint8_t> adu) {
+        auto transaction = co_await co_submit(std::move(adu));
+        co_return co_await co_result(transaction);
+    }
+
+    /**
+     * @brief Send several requests back-to-back and wait for all their responses
+     *
+     * @param adus request message buffers
+     * @return response message buffers, in request order
+     */
+    awaitable<std::vector<std::vector<std::uint8_t>>> co_transact_all(std::vector<std::vector<std::uint8_t>> adus) {
+        std::vector<TransactionPtr> transactions;
+        transactions.reserve(adus.size());
+        for (auto& adu : adus) {
+            transactions.push_back(co_await co_submit(std::move(adu)));
+        }
+
+        std::vector<std::vector<std::uint8_t>> responses;
+        responses.reserve(transactions.size());
+        for (auto& transaction : transactions) {
+            responses.push_back(co_await co_result(transaction));
+        }
+        co_return responses;
+    }
+
+    /**
+     * @brief co_transact_all() from any thread
+     *
+     * @param adus request message buffers
+     * @return response message buffers, in request order
+     */
+    std::future<std::vector<std::vector<std::uint8_t>>> transact_all(std::vector<std::vector<std::uint8_t>> adus) {
+        return co_spawn(executor_,
+            [self = shared_from_this(), adus = std::move(adus)]() mutable {
+                return self->co_transact_all(std::move(adus));
+            },
+            asio::use_future);
+    }
+
+    /**
+     * @brief Send a request from any thread, the future completes with the response
+     *
+     * @param adu request message buffer
+     * @return response message buffer (MBAP header + PDU)
+     */
+    std::future<std::vector<std::uint8_t>> transact(std::vector<std::uint8_t> adu) {
+        return co_spawn(executor_,
+            [self = shared_from_this(), adu = std::move(adu)]() mutable {
+                return self->co_transact(std::move(adu));
+            },
+            asio::use_future);
+    }
+};
+
+} // namespace modbus
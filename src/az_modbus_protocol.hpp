@@ -8,6 +8,12 @@
 #include <stdexcept>
 #include <iostream>
 #include <variant>
+#include <expected>
+#include <string_view>
+#include <span>
+#include <type_traits>
+
+#include "az_simd.hpp"
 
 namespace modbus {
 
@@ -16,6 +22,29 @@ namespace modbus {
  */
 constexpr size_t MBAP_HEADER_SIZE = 7;
 
+/**
+ * @brief Maximum TCP ADU size (MBAP header + 253 bytes PDU)
+ */
+constexpr size_t MAX_ADU_SIZE = 260;
+
+/**
+ * @brief Fixed size buffer able to hold any ADU
+ */
+using AduFrame = std::array<std::uint8_t, MAX_ADU_SIZE>;
+
+/**
+ * @brief Maximum quantity per read request
+ */
+constexpr std::uint16_t MAX_READ_BITS = 2000;
+constexpr std::uint16_t MAX_READ_REGISTERS = 125;
+
+/**
+ * @brief Maximum quantity per write multiple request
+ */
+constexpr std::uint16_t MAX_WRITE_BITS = 1968;
+constexpr std::uint16_t MAX_WRITE_REGISTERS = 123;
+constexpr std::uint16_t MAX_READ_WRITE_REGISTERS = 121; // Write part of FC 0x17
+
 /**
  * @brief Modbus exception code
  */
@@ -23,6 +52,52 @@ constexpr uint8_t EXC_ILLEGAL_FUNCTION = 0x01;
 constexpr uint8_t EXC_ILLEGAL_DATA_ADDRESS = 0x02;
 constexpr uint8_t EXC_ILLEGAL_DATA_VALUE = 0x03;
 constexpr uint8_t EXC_SLAVE_DEVICE_FAILURE = 0x04;
+constexpr uint8_t EXC_GATEWAY_PATH_UNAVAILABLE = 0x0A;
+constexpr uint8_t EXC_GATEWAY_TARGET_FAILED = 0x0B;
+
+/**
+ * @brief Number of unit IDs (one byte in the MBAP header)
+ */
+constexpr size_t MAX_UNIT_IDS = 256;
+
+/**
+ * @brief Name of a Modbus exception code
+ *
+ * @param code exception code number
+ * @return constant string, "EXC_UNKNOWN" for codes without a name
+ */
+inline std::string_view exception_name(std::uint8_t code) {
+    switch (code) {
+        case EXC_ILLEGAL_FUNCTION: return "EXC_ILLEGAL_FUNCTION";
+        case EXC_ILLEGAL_DATA_ADDRESS: return "EXC_ILLEGAL_DATA_ADDRESS";
+        case EXC_ILLEGAL_DATA_VALUE: return "EXC_ILLEGAL_DATA_VALUE";
+        case EXC_SLAVE_DEVICE_FAILURE: return "EXC_SLAVE_DEVICE_FAILURE";
+        case EXC_GATEWAY_PATH_UNAVAILABLE: return "EXC_GATEWAY_PATH_UNAVAILABLE";
+        case EXC_GATEWAY_TARGET_FAILED: return "EXC_GATEWAY_TARGET_FAILED";
+        default: return "EXC_UNKNOWN";
+    }
+}
+
+/**
+ * @brief Errors of the non-throwing (try_) decoders for frames that can not be answered
+ */
+enum class DecodeError : std::uint8_t {
+    BufferTooShort,    // Fewer bytes than an MBAP header
+    InvalidProtocolId, // Protocol ID other than 0x0000
+    InvalidLength      // MBAP length shorter than a PDU or longer than an ADU
+};
+
+/**
+ * @brief Name of a decode error, for logging
+ */
+inline std::string_view decode_error_name(DecodeError error) {
+    switch (error) {
+        case DecodeError::BufferTooShort: return "MBAP header too short";
+        case DecodeError::InvalidProtocolId: return "invalid Protocol ID";
+        case DecodeError::InvalidLength: return "invalid MBAP length";
+    }
+    return "unknown error";
+}
 
 /**
  * @brief Protocol Constants
@@ -33,7 +108,10 @@ enum FunctionCode : std::uint8_t {
     HoldingRegisters = 0x03,
     InputRegisters = 0x04,
     WriteSingleCoil = 0x05,
-    WriteSingleRegister = 0x06
+    WriteSingleRegister = 0x06,
+    WriteMultipleCoils = 0x0F,
+    WriteMultipleRegisters = 0x10,
+    ReadWriteMultipleRegisters = 0x17
  };
 
 /**
@@ -54,6 +132,9 @@ struct RequestData {
     std::uint16_t start_addr;
     std::uint16_t number;
     std::uint16_t value;
+    std::span<const std::uint8_t> payload = {}; // Write multiple data (packed coils or big endian registers), refers to the request buffer
+    std::uint16_t write_addr = 0;   // FC 0x17 write start address (start_addr/number describe the read)
+    std::uint16_t write_number = 0; // FC 0x17 write quantity
 };
 
 /**
@@ -112,39 +193,68 @@ inline std::uint16_t from_big_endian(std::uint8_t high, std::uint8_t low) {
     return (static_cast<std::uint16_t>(high) << 8) | static_cast<std::uint16_t>(low);
 }
 
+/**
+ * @brief Exception check without throwing
+ *
+ * @param pdu response PDU
+ * @return the PDU, or the exception code when the PDU is an exception response
+ */
+inline std::expected<std::span<const std::uint8_t>, std::uint8_t> try_check_exception(std::span<const std::uint8_t> pdu) {
+    if (pdu.empty())
+        return std::unexpected(EXC_ILLEGAL_DATA_VALUE);
+    if (pdu[0] & 0x80)
+        return std::unexpected(pdu.size() > 1 ? pdu[1] : EXC_ILLEGAL_DATA_VALUE);
+    return pdu;
+}
+
 /**
  * @brief Exceptions handler
  *
- * @param expected_fc Function code
  * @param pdu Message PDU to be processed
  */
-inline void check_exception(const std::vector<std::uint8_t>& pdu) {
-    if (pdu[0] == (0x01 | 0x80)) {
-        throw std::runtime_error("Modbus Exception: " + std::to_string(pdu[1]));
+inline void check_exception(std::span<const std::uint8_t> pdu) {
+    auto checked = try_check_exception(pdu);
+    if (!checked) {
+        throw std::runtime_error("Modbus Exception: " + std::to_string(checked.error()));
     }
 }
 
 /**
- * @brief Create the MBAP header
+ * @brief Check that an output buffer can hold the frame being encoded
  *
- * @param adu message buffer to be filled
+ * @param adu output buffer
+ * @param size number of bytes required
+ */
+inline void check_adu_capacity(std::span<const std::uint8_t> adu, size_t size) {
+    if (adu.size() < size)
+        throw std::runtime_error("ADU buffer too small");
+}
+
+/**
+ * @brief Encode the MBAP header into a caller provided buffer
+ *
+ * @param adu output buffer, at least MBAP_HEADER_SIZE bytes
  * @param pdu_size message payload size
  * @param transaction_id transactionid nunmber
  * @param unit_id device unit number
  */
-inline void create_mbap_header(
-    std::vector<std::uint8_t> &adu,
+inline void encode_mbap_header(
+    std::span<std::uint8_t> adu,
     const std::uint16_t pdu_size,
     std::uint16_t transaction_id,
     std::uint8_t unit_id)
 {
+    check_adu_capacity(adu, MBAP_HEADER_SIZE);
+
     // MBAP Header (7 bytes)
     auto tid_bytes = to_big_endian(transaction_id);
     auto len_bytes = to_big_endian(pdu_size + 1); // Length = PDU + 1B Unit ID
 
     // 0-1: Transaction ID
     std::copy(tid_bytes.begin(), tid_bytes.end(), adu.begin());
-    // 2-3: Protocol ID (0x0000) - Já é 0 por padrão no vector
+    // 2-3: Protocol ID (0x0000)
+    adu[2] = 0x00;
+    adu[3] = 0x00;
     // 4-5: Length
     std::copy(len_bytes.begin(), len_bytes.end(), adu.begin() + 4);
     // 6: Unit ID
@@ -152,16 +262,35 @@ inline void create_mbap_header(
 }
 
 /**
- * @brief Create the frame for read function code
+ * @brief Create the MBAP header
+ *
+ * @param adu message buffer to be filled
+ * @param pdu_size message payload size
+ * @param transaction_id transactionid nunmber
+ * @param unit_id device unit number
+ */
+inline void create_mbap_header(
+    std::vector<std::uint8_t> &adu,
+    const std::uint16_t pdu_size,
+    std::uint16_t transaction_id,
+    std::uint8_t unit_id)
+{
+    encode_mbap_header(adu, pdu_size, transaction_id, unit_id);
+}
+
+/**
+ * @brief Encode the frame for read function code into a caller provided buffer
  *
+ * @param adu output buffer
  * @param transaction_id transactionid nunmber
  * @param unit_id device unit number
  * @param start_address start adress number
  * @param quantity quantity of addresses
  * @param function_code function code number
- * @return message buffer
+ * @return number of bytes written
  */
-inline std::vector<std::uint8_t> create_read_adu(
+inline size_t encode_read_adu(
+    std::span<std::uint8_t> adu,
     std::uint16_t transaction_id,
     std::uint8_t unit_id,
     std::uint16_t start_address,
@@ -172,8 +301,8 @@ inline std::vector<std::uint8_t> create_read_adu(
     const std::uint16_t pdu_size = 5;
 
     // ADU size (MBAP Header 7B + PDU 5B) = 12
-    std::vector<std::uint8_t> adu(MBAP_HEADER_SIZE + pdu_size);
-    create_mbap_header(adu, pdu_size, transaction_id, unit_id);
+    check_adu_capacity(adu, MBAP_HEADER_SIZE + pdu_size);
+    encode_mbap_header(adu, pdu_size, transaction_id, unit_id);
 
     // 7: Function Code (0x01)
     adu[7] = function_code;
@@ -186,20 +315,76 @@ inline std::vector<std::uint8_t> create_read_adu(
     auto qty_bytes = to_big_endian(quantity);
     std::copy(qty_bytes.begin(), qty_bytes.end(), adu.begin() + 10);
 
+    return MBAP_HEADER_SIZE + pdu_size;
+}
+
+/**
+ * @brief Create the frame for read function code
+ *
+ * @param transaction_id transactionid nunmber
+ * @param unit_id device unit number
+ * @param start_address start adress number
+ * @param quantity quantity of addresses
+ * @param function_code function code number
+ * @return message buffer
+ */
+inline std::vector<std::uint8_t> create_read_adu(
+    std::uint16_t transaction_id,
+    std::uint8_t unit_id,
+    std::uint16_t start_address,
+    std::uint16_t quantity,
+    FunctionCode function_code)
+{
+    std::vector<std::uint8_t> adu(MBAP_HEADER_SIZE + 5);
+    encode_read_adu(adu, transaction_id, unit_id, start_address, quantity, function_code);
     return adu;
 }
 
 /**
- * @brief Create the frame for Write values
+ * @brief Split a read of any length into requests within the protocol limits
+ *
+ * @param unit_id device unit number
+ * @param start_address first address
+ * @param quantity quantity of addresses, may exceed max_read_quantity()
+ * @param function_code FC 0x01 - 0x04
+ * @return one request per chunk, transaction IDs left at 0
+ */
+inline std::vector<std::vector<std::uint8_t>> create_read_requests(
+    std::uint8_t unit_id,
+    std::uint16_t start_address,
+    size_t quantity,
+    FunctionCode function_code)
+{
+    if (quantity == 0)
+        throw std::runtime_error("invalid read quantity");
+    if (start_address + quantity > 0x10000)
+        throw std::runtime_error("read range exceeds the address space");
+
+    size_t max_chunk = (function_code == ReadCoils || function_code == ReadDiscreteInputs) ? MAX_READ_BITS : MAX_READ_REGISTERS;
+    std::vector<std::vector<std::uint8_t>> requests;
+    requests.reserve((quantity + max_chunk - 1) / max_chunk);
+    for (size_t offset = 0; offset < quantity; offset += max_chunk) {
+        requests.push_back(create_read_adu(0, unit_id,
+            static_cast<std::uint16_t>(start_address + offset),
+            static_cast<std::uint16_t>(std::min(max_chunk, quantity - offset)),
+            function_code));
+    }
+    return requests;
+}
+
+/**
+ * @brief Encode the frame for Write values into a caller provided buffer
  *
+ * @param adu output buffer
  * @param transaction_id transactionid nunmber
  * @param unit_id device unit number
  * @param address adress number
  * @param value value to be applyed
  * @param function_code function code number
- * @return message buffer
+ * @return number of bytes written
  */
-inline std::vector<std::uint8_t> create_write_adu(
+inline size_t encode_write_adu(
+    std::span<std::uint8_t> adu,
     std::uint16_t transaction_id,
     std::uint8_t unit_id,
     std::uint16_t address,
@@ -207,8 +392,8 @@ inline std::vector<std::uint8_t> create_write_adu(
     FunctionCode function_code)
 {
     const std::uint16_t pdu_size = 5;
-    std::vector<std::uint8_t> adu(MBAP_HEADER_SIZE + pdu_size);
-    create_mbap_header(adu, pdu_size, transaction_id, unit_id);
+    check_adu_capacity(adu, MBAP_HEADER_SIZE + pdu_size);
+    encode_mbap_header(adu, pdu_size, transaction_id, unit_id);
 
     // PDU
     adu[7] = function_code;
@@ -217,14 +402,15 @@ inline std::vector<std::uint8_t> create_write_adu(
     auto addr_bytes = to_big_endian(address);
     std::copy(addr_bytes.begin(), addr_bytes.end(), adu.begin() + 8);
 
+    // 10-11: Output Value
+    adu[10] = 0x00;
+    adu[11] = 0x00;
+
     if(function_code == modbus::FunctionCode::WriteSingleCoil) {
         // 10-11: Output Value (0xFF00 para ON, 0x0000 para OFF)
         if (value == 1) {
             adu[10] = 0xFF; // High
             adu[11] = 0x00; // Low
-        } else {
-            adu[10] = 0x00; // High
-            adu[11] = 0x00; // Low
         }
     }
     else if(function_code == modbus::FunctionCode::WriteSingleRegister) {
@@ -232,9 +418,390 @@ inline std::vector<std::uint8_t> create_write_adu(
         std::copy(value_bytes.begin(), value_bytes.end(), adu.begin() + 10);
     }
 
+    return MBAP_HEADER_SIZE + pdu_size;
+}
+
+/**
+ * @brief Create the frame for Write values
+ *
+ * @param transaction_id transactionid nunmber
+ * @param unit_id device unit number
+ * @param address adress number
+ * @param value value to be applyed
+ * @param function_code function code number
+ * @return message buffer
+ */
+inline std::vector<std::uint8_t> create_write_adu(
+    std::uint16_t transaction_id,
+    std::uint8_t unit_id,
+    std::uint16_t address,
+    std::uint16_t value,
+    FunctionCode function_code)
+{
+    std::vector<std::uint8_t> adu(MBAP_HEADER_SIZE + 5);
+    encode_write_adu(adu, transaction_id, unit_id, address, value, function_code);
     return adu;
 }
 
+/**
+ * @brief Encode the header of a write multiple request (FC 0x0F / 0x10) into a caller provided buffer
+ *
+ * @param adu output buffer
+ * @param transaction_id transactionid nunmber
+ * @param unit_id device unit number
+ * @param start_address first address to be written
+ * @param quantity quantity of addresses
+ * @param byte_count size of the data following the header
+ * @param function_code WriteMultipleCoils or WriteMultipleRegisters
+ * @return number of bytes written, the data starts at this offset
+ */
+inline size_t encode_write_multiple_header(
+    std::span<std::uint8_t> adu,
+    std::uint16_t transaction_id,
+    std::uint8_t unit_id,
+    std::uint16_t start_address,
+    std::uint16_t quantity,
+    std::uint8_t byte_count,
+    FunctionCode function_code)
+{
+    // PDU Size (1B FC + 2B Address + 2B Quantity + 1B Byte Count + N data)
+    const std::uint16_t pdu_size = 6 + byte_count;
+    check_adu_capacity(adu, MBAP_HEADER_SIZE + pdu_size);
+    encode_mbap_header(adu, pdu_size, transaction_id, unit_id);
+
+    adu[7] = function_code;
+
+    auto addr_bytes = to_big_endian(start_address);
+    std::copy(addr_bytes.begin(), addr_bytes.end(), adu.begin() + 8);
+
+    auto qty_bytes = to_big_endian(quantity);
+    std::copy(qty_bytes.begin(), qty_bytes.end(), adu.begin() + 10);
+
+    adu[12] = byte_count;
+    return MBAP_HEADER_SIZE + 6;
+}
+
+/**
+ * @brief Encode a Write Multiple Coils request (FC 0x0F) into a caller provided buffer
+ *
+ * @param adu output buffer
+ * @param transaction_id transactionid nunmber
+ * @param unit_id device unit number
+ * @param start_address first coil
+ * @param coils coil values, one byte per coil (non zero = ON), at most MAX_WRITE_BITS
+ * @return number of bytes written
+ */
+inline size_t encode_write_multiple_coils_adu(
+    std::span<std::uint8_t> adu,
+    std::uint16_t transaction_id,
+    std::uint8_t unit_id,
+    std::uint16_t start_address,
+    std::span<const std::uint8_t> coils)
+{
+    if (coils.empty() || coils.size() > MAX_WRITE_BITS)
+        throw std::runtime_error("invalid coil quantity");
+
+    auto byte_count = static_cast<std::uint8_t>((coils.size() + 7) / 8);
+    size_t offset = encode_write_multiple_header(adu, transaction_id, unit_id, start_address,
+        static_cast<std::uint16_t>(coils.size()), byte_count, FunctionCode::WriteMultipleCoils);
+    simd::pack_bits(coils, adu.subspan(offset, byte_count));
+    return offset + byte_count;
+}
+
+/**
+ * @brief Encode a Write Multiple Registers request (FC 0x10) into a caller provided buffer
+ *
+ * @param adu output buffer
+ * @param transaction_id transactionid nunmber
+ * @param unit_id device unit number
+ * @param start_address first register
+ * @param registers register values (host endian), at most MAX_WRITE_REGISTERS
+ * @return number of bytes written
+ */
+inline size_t encode_write_multiple_registers_adu(
+    std::span<std::uint8_t> adu,
+    std::uint16_t transaction_id,
+    std::uint8_t unit_id,
+    std::uint16_t start_address,
+    std::span<const std::uint16_t> registers)
+{
+    if (registers.empty() || registers.size() > MAX_WRITE_REGISTERS)
+        throw std::runtime_error("invalid register quantity");
+
+    auto byte_count = static_cast<std::uint8_t>(registers.size() * 2);
+    size_t offset = encode_write_multiple_header(adu, transaction_id, unit_id, start_address,
+        static_cast<std::uint16_t>(registers.size()), byte_count, FunctionCode::WriteMultipleRegisters);
+    simd::store_big_endian(registers, adu.subspan(offset, byte_count));
+    return offset + byte_count;
+}
+
+/**
+ * @brief Create the frame for Write Multiple Coils (FC 0x0F)
+ *
+ * @param transaction_id transactionid nunmber
+ * @param unit_id device unit number
+ * @param start_address first coil
+ * @param coils coil values, one byte per coil, at most MAX_WRITE_BITS
+ * @return message buffer
+ */
+inline std::vector<std::uint8_t> create_write_multiple_coils_adu(
+    std::uint16_t transaction_id,
+    std::uint8_t unit_id,
+    std::uint16_t start_address,
+    std::span<const std::uint8_t> coils)
+{
+    std::vector<std::uint8_t> adu(MBAP_HEADER_SIZE + 6 + (coils.size() + 7) / 8);
+    encode_write_multiple_coils_adu(adu, transaction_id, unit_id, start_address, coils);
+    return adu;
+}
+
+/**
+ * @brief Create the frame for Write Multiple Registers (FC 0x10)
+ *
+ * @param transaction_id transactionid nunmber
+ * @param unit_id device unit number
+ * @param start_address first register
+ * @param registers register values (host endian), at most MAX_WRITE_REGISTERS
+ * @return message buffer
+ */
+inline std::vector<std::uint8_t> create_write_multiple_registers_adu(
+    std::uint16_t transaction_id,
+    std::uint8_t unit_id,
+    std::uint16_t start_address,
+    std::span<const std::uint16_t> registers)
+{
+    std::vector<std::uint8_t> adu(MBAP_HEADER_SIZE + 6 + registers.size() * 2);
+    encode_write_multiple_registers_adu(adu, transaction_id, unit_id, start_address, registers);
+    return adu;
+}
+
+/**
+ * @brief Split a write of any length into Write Multiple requests within the protocol limits
+ *
+ * @param unit_id device unit number
+ * @param start_address first address
+ * @param values coils (one byte per coil) or registers (host endian)
+ * @return one request per chunk, transaction IDs left at 0
+ */
+template <typename T>
+inline std::vector<std::vector<std::uint8_t>> create_write_multiple_requests(
+    std::uint8_t unit_id,
+    std::uint16_t start_address,
+    std::span<const T> values)
+{
+    static_assert(std::is_same_v<T, std::uint8_t> || std::is_same_v<T, std::uint16_t>);
+    constexpr size_t max_chunk = std::is_same_v<T, std::uint8_t> ? MAX_WRITE_BITS : MAX_WRITE_REGISTERS;
+
+    if (start_address + values.size() > 0x10000)
+        throw std::runtime_error("write range exceeds the address space");
+
+    std::vector<std::vector<std::uint8_t>> requests;
+    for (size_t offset = 0; offset < values.size(); offset += max_chunk) {
+        auto chunk = values.subspan(offset, std::min(max_chunk, values.size() - offset));
+        auto address = static_cast<std::uint16_t>(start_address + offset);
+        if constexpr (std::is_same_v<T, std::uint8_t>)
+            requests.push_back(create_write_multiple_coils_adu(0, unit_id, address, chunk));
+        else
+            requests.push_back(create_write_multiple_registers_adu(0, unit_id, address, chunk));
+    }
+    return requests;
+}
+
+/**
+ * @brief Encode a Read/Write Multiple Registers request (FC 0x17) into a caller provided buffer
+ *
+ * @param adu output buffer
+ * @param transaction_id transactionid nunmber
+ * @param unit_id device unit number
+ * @param read_address first register to read
+ * @param read_quantity registers to read, at most MAX_READ_REGISTERS
+ * @param write_address first register to write
+ * @param registers registers to write (host endian), at most MAX_READ_WRITE_REGISTERS
+ * @return number of bytes written
+ */
+inline size_t encode_read_write_registers_adu(
+    std::span<std::uint8_t> adu,
+    std::uint16_t transaction_id,
+    std::uint8_t unit_id,
+    std::uint16_t read_address,
+    std::uint16_t read_quantity,
+    std::uint16_t write_address,
+    std::span<const std::uint16_t> registers)
+{
+    if (read_quantity == 0 || read_quantity > MAX_READ_REGISTERS)
+        throw std::runtime_error("invalid read quantity");
+    if (registers.empty() || registers.size() > MAX_READ_WRITE_REGISTERS)
+        throw std::runtime_error("invalid register quantity");
+
+    // PDU Size (1B FC + 2B Read Address + 2B Read Quantity + 2B Write Address + 2B Write Quantity + 1B Byte Count + N data)
+    auto byte_count = static_cast<std::uint8_t>(registers.size() * 2);
+    const std::uint16_t pdu_size = 10 + byte_count;
+    check_adu_capacity(adu, MBAP_HEADER_SIZE + pdu_size);
+    encode_mbap_header(adu, pdu_size, transaction_id, unit_id);
+
+    adu[7] = FunctionCode::ReadWriteMultipleRegisters;
+
+    auto fields = {read_address, read_quantity, write_address, static_cast<std::uint16_t>(registers.size())};
+    size_t offset = 8;
+    for (std::uint16_t field : fields) {
+        auto field_bytes = to_big_endian(field);
+        std::copy(field_bytes.begin(), field_bytes.end(), adu.begin() + offset);
+        offset += 2;
+    }
+
+    adu[offset++] = byte_count;
+    simd::store_big_endian(registers, adu.subspan(offset, byte_count));
+    return offset + byte_count;
+}
+
+/**
+ * @brief Create the frame for Read/Write Multiple Registers (FC 0x17)
+ *
+ * @param transaction_id transactionid nunmber
+ * @param unit_id device unit number
+ * @param read_address first register to read
+ * @param read_quantity registers to read, at most MAX_READ_REGISTERS
+ * @param write_address first register to write
+ * @param registers registers to write (host endian), at most MAX_READ_WRITE_REGISTERS
+ * @return message buffer
+ */
+inline std::vector<std::uint8_t> create_read_write_registers_adu(
+    std::uint16_t transaction_id,
+    std::uint8_t unit_id,
+    std::uint16_t read_address,
+    std::uint16_t read_quantity,
+    std::uint16_t write_address,
+    std::span<const std::uint16_t> registers)
+{
+    std::vector<std::uint8_t> adu(MBAP_HEADER_SIZE + 10 + registers.size() * 2);
+    encode_read_write_registers_adu(adu, transaction_id, unit_id, read_address, read_quantity, write_address, registers);
+    return adu;
+}
+
+/**
+ * @brief Encode the Write Multiple response (FC 0x0F / 0x10) into a caller provided buffer
+ *
+ * @param adu output buffer
+ * @param header_data struct with header data
+ * @param pdu_data request being answered
+ * @return number of bytes written
+ */
+inline size_t encode_write_multiple_response(
+    std::span<std::uint8_t> adu,
+    const MbapHeader header_data,
+    const RequestData pdu_data)
+{
+    // Echo of FC + Start Address + Quantity
+    const std::uint16_t pdu_size = 5;
+    check_adu_capacity(adu, MBAP_HEADER_SIZE + pdu_size);
+    encode_mbap_header(adu, pdu_size, header_data.transaction_id, header_data.unit_id);
+
+    adu[7] = pdu_data.func_code;
+
+    auto addr_bytes = to_big_endian(pdu_data.start_addr);
+    std::copy(addr_bytes.begin(), addr_bytes.end(), adu.begin() + 8);
+
+    auto qty_bytes = to_big_endian(pdu_data.number);
+    std::copy(qty_bytes.begin(), qty_bytes.end(), adu.begin() + 10);
+
+    return MBAP_HEADER_SIZE + pdu_size;
+}
+
+/**
+ * @brief Encode the MBAP header, function code and byte count of a read response
+ *
+ * The caller fills the byte_count data bytes that follow.
+ *
+ * @param adu output buffer
+ * @param header_data struct with header data
+ * @param function_code function code number
+ * @param byte_count number of data bytes
+ * @return total ADU size including the data bytes
+ */
+inline size_t encode_read_response_header(
+    std::span<std::uint8_t> adu,
+    const MbapHeader header_data,
+    std::uint8_t function_code,
+    size_t byte_count)
+{
+    size_t pdu_size = 2 + byte_count;
+    check_adu_capacity(adu, MBAP_HEADER_SIZE + pdu_size);
+
+    encode_mbap_header(adu, static_cast<uint16_t>(pdu_size), header_data.transaction_id, header_data.unit_id);
+    adu[7] = function_code;
+    adu[8] = static_cast<uint8_t>(byte_count);
+    return MBAP_HEADER_SIZE + pdu_size;
+}
+
+/**
+ * @brief Response ADU kept as a header and a payload in separate buffers
+ *
+ * Read responses leave their data where it was produced, the frame is then
+ * sent as a two buffer gather write instead of being joined first. Every other
+ * response fits in the header and has an empty payload.
+ */
+struct ResponseFrame {
+    std::array<std::uint8_t, MBAP_HEADER_SIZE + 5> header{}; // MBAP + FC + address + value (longest fixed response)
+    size_t header_size = 0;
+    std::span<const std::uint8_t> payload;
+
+    std::span<const std::uint8_t> header_bytes() const {
+        return std::span<const std::uint8_t>(header).first(header_size);
+    }
+
+    size_t size() const {
+        return header_size + payload.size();
+    }
+};
+
+/**
+ * @brief Encode the header of a read response referring to an external payload
+ *
+ * @param frame output frame
+ * @param header_data struct with header data
+ * @param function_code function code number
+ * @param payload data bytes (packed bits or big endian registers), must outlive the frame
+ * @return total ADU size
+ */
+inline size_t encode_read_response_frame(
+    ResponseFrame& frame,
+    const MbapHeader header_data,
+    std::uint8_t function_code,
+    std::span<const std::uint8_t> payload)
+{
+    if (payload.size() > MAX_ADU_SIZE - MBAP_HEADER_SIZE - 2)
+        throw std::runtime_error("ADU buffer too small");
+
+    encode_mbap_header(frame.header, static_cast<std::uint16_t>(2 + payload.size()), header_data.transaction_id, header_data.unit_id);
+    frame.header[7] = function_code;
+    frame.header[8] = static_cast<std::uint8_t>(payload.size());
+    frame.header_size = MBAP_HEADER_SIZE + 2;
+    frame.payload = payload;
+    return frame.size();
+}
+
+/**
+ * @brief Encode a read bits response into a caller provided buffer
+ *
+ * @param adu output buffer
+ * @param header_data struct with header data
+ * @param pdu_data struct with pdu data
+ * @param bits one byte per coil, non zero means ON
+ * @return number of bytes written
+ */
+inline size_t encode_read_bits(
+    std::span<std::uint8_t> adu,
+    const MbapHeader header_data,
+    const RequestData pdu_data,
+    std::span<const std::uint8_t> bits)
+{
+    size_t byte_count = (pdu_data.number + 7) / 8;
+    size_t adu_size = encode_read_response_header(adu, header_data, pdu_data.func_code, byte_count);
+
+    simd::pack_bits(bits.first(pdu_data.number), adu.subspan(MBAP_HEADER_SIZE + 2, byte_count));
+    return adu_size;
+}
+
 /**
  * @brief BIT coil handler to process read messages
  *
@@ -248,31 +815,31 @@ inline std::vector<uint8_t> handle_read_bits(
     const RequestData pdu_data,
     const std::vector<uint8_t>& pdu_response_buffer)
 {
-    uint8_t start_id = static_cast<uint8_t>(pdu_data.start_addr);
-    size_t byte_count = (pdu_data.number + 7) / 8;
-    std::vector<uint8_t> data_bytes(byte_count, 0);
-
-    for (int i = 0; i < pdu_data.number; ++i) {
-        uint8_t bit_value = pdu_response_buffer[i];
-
-        if (bit_value != 0) {
-            data_bytes[i / 8] |= (1 << (i % 8));
-        }
-    }
-
-    std::vector<uint8_t> pdu_response;
-    pdu_response.push_back(pdu_data.func_code);
-    pdu_response.push_back(static_cast<uint8_t>(byte_count));
-    pdu_response.insert(pdu_response.end(), data_bytes.begin(), data_bytes.end());
-
-    std::vector<uint8_t> adu_response;
-    std::vector<uint8_t> mbap_response_header(MBAP_HEADER_SIZE);
-    create_mbap_header(mbap_response_header, (uint16_t)pdu_response.size(), header_data.transaction_id, header_data.unit_id);
+    std::vector<uint8_t> adu_response(MBAP_HEADER_SIZE + 2 + (pdu_data.number + 7) / 8);
+    encode_read_bits(adu_response, header_data, pdu_data, pdu_response_buffer);
+    return adu_response;
+}
 
-    adu_response.insert(adu_response.end(), mbap_response_header.begin(), mbap_response_header.end());
-    adu_response.insert(adu_response.end(), pdu_response.begin(), pdu_response.end());
+/**
+ * @brief Encode a read registers response into a caller provided buffer
+ *
+ * @param adu output buffer
+ * @param header_data struct with header data
+ * @param pdu_data struct with pdu data
+ * @param registers register values (host endian)
+ * @return number of bytes written
+ */
+inline size_t encode_read_registers(
+    std::span<std::uint8_t> adu,
+    const MbapHeader header_data,
+    const RequestData pdu_data,
+    std::span<const std::uint16_t> registers)
+{
+    size_t byte_count = pdu_data.number * 2;
+    size_t adu_size = encode_read_response_header(adu, header_data, pdu_data.func_code, byte_count);
 
-    return adu_response;
+    simd::store_big_endian(registers.first(pdu_data.number), adu.subspan(MBAP_HEADER_SIZE + 2, byte_count));
+    return adu_size;
 }
 
 /**
@@ -288,31 +855,190 @@ inline std::vector<uint8_t> handle_read_registers(
     const RequestData pdu_data,
     const std::vector<uint16_t>& pdu_response_buffer)
 {
-    uint8_t start_id = static_cast<uint8_t>(pdu_data.start_addr);
-    size_t byte_count = pdu_data.number * 2;
-    std::vector<uint8_t> data_bytes;
-    data_bytes.reserve(byte_count);
+    std::vector<uint8_t> adu_response(MBAP_HEADER_SIZE + 2 + pdu_data.number * 2);
+    encode_read_registers(adu_response, header_data, pdu_data, pdu_response_buffer);
+    return adu_response;
+}
+
+/**
+ * @brief Non-owning view over a received MBAP header
+ *
+ * The buffer is validated once on construction, the fields are decoded on access.
+ * The view must not outlive the buffer it refers to.
+ */
+class MbapHeaderView {
+private:
+    std::span<const std::uint8_t> buffer_;
+
+public:
+    explicit MbapHeaderView(std::span<const std::uint8_t> buffer) : buffer_(buffer) {
+        if (buffer_.size() < MBAP_HEADER_SIZE)
+            throw std::runtime_error("MBAP header too short");
+        if (protocol_id() != 0x0000)
+            throw std::runtime_error("invalid Protocol ID");
+    }
+
+    std::uint16_t transaction_id() const { return from_big_endian(buffer_[0], buffer_[1]); }
+    std::uint16_t protocol_id() const { return from_big_endian(buffer_[2], buffer_[3]); }
+    std::uint16_t length() const { return from_big_endian(buffer_[4], buffer_[5]); }
+    std::uint8_t unit_id() const { return buffer_[6]; }
+
+    /**
+     * @brief PDU size announced by the header (length without the unit ID)
+     */
+    size_t pdu_size() const { return length() > 0 ? length() - 1 : 0; }
+
+    /**
+     * @brief PDU bytes following the header, when the view covers a whole ADU
+     */
+    std::span<const std::uint8_t> pdu() const {
+        return buffer_.subspan(MBAP_HEADER_SIZE, std::min(pdu_size(), buffer_.size() - MBAP_HEADER_SIZE));
+    }
+
+    MbapHeader header() const {
+        return MbapHeader{transaction_id(), protocol_id(), length(), unit_id()};
+    }
+};
 
-    for (int i = 0; i < pdu_data.number; ++i) {
-        uint16_t reg_value = pdu_response_buffer[i];
-        data_bytes.push_back(static_cast<uint8_t>(reg_value >> 8));   // MSB
-        data_bytes.push_back(static_cast<uint8_t>(reg_value & 0xFF)); // LSB
+/**
+ * @brief Non-owning view over a received PDU
+ *
+ * Request PDUs expose the address/quantity fields, response PDUs expose the
+ * byte count and the data payload. The view must not outlive the buffer it refers to.
+ */
+class PduView {
+private:
+    std::span<const std::uint8_t> pdu_;
+
+public:
+    explicit PduView(std::span<const std::uint8_t> pdu) : pdu_(pdu) {
+        if (pdu_.size() < 2)
+            throw std::runtime_error("PDU too short");
     }
 
-    std::vector<uint8_t> pdu_response;
-    pdu_response.push_back(pdu_data.func_code);
-    pdu_response.push_back(static_cast<uint8_t>(byte_count));
-    pdu_response.insert(pdu_response.end(), data_bytes.begin(), data_bytes.end());
+    std::uint8_t function_code() const { return pdu_[0]; }
+    bool is_exception() const { return (pdu_[0] & 0x80) != 0; }
+    std::uint8_t exception_code() const { return pdu_[1]; }
+    size_t size() const { return pdu_.size(); }
+    std::span<const std::uint8_t> bytes() const { return pdu_; }
+
+    // Request fields: FC(1) + Address(2) + Quantity/Value(2)
+    bool has_address_fields() const { return pdu_.size() >= 5; }
+    std::uint16_t start_addr() const { return from_big_endian(pdu_[1], pdu_[2]); }
+    std::uint16_t number() const { return from_big_endian(pdu_[3], pdu_[4]); }
+
+    // Write multiple request fields: FC(1) + Address(2) + Quantity(2) + Byte Count(1) + Data(N)
+    bool has_write_payload() const { return pdu_.size() >= 6 && pdu_.size() == size_t{6} + pdu_[5]; }
+    std::uint8_t write_byte_count() const { return pdu_[5]; }
+    std::span<const std::uint8_t> write_data() const { return pdu_.subspan(6); }
+
+    // Read/Write Multiple Registers request fields (FC 0x17): the read fields come first,
+    // then Write Address(2) + Write Quantity(2) + Byte Count(1) + Data(N)
+    bool has_read_write_payload() const { return pdu_.size() >= 10 && pdu_.size() == size_t{10} + pdu_[9]; }
+    std::uint16_t rw_write_addr() const { return from_big_endian(pdu_[5], pdu_[6]); }
+    std::uint16_t rw_write_number() const { return from_big_endian(pdu_[7], pdu_[8]); }
+    std::uint8_t rw_byte_count() const { return pdu_[9]; }
+    std::span<const std::uint8_t> rw_write_data() const { return pdu_.subspan(10); }
+
+    // Read response fields: FC(1) + Byte Count(1) + Data(N)
+    std::uint8_t byte_count() const { return pdu_[1]; }
+    bool has_valid_byte_count() const { return pdu_.size() == size_t{2} + byte_count(); }
+    std::span<const std::uint8_t> data() const { return pdu_.subspan(2); }
+};
 
-    std::vector<uint8_t> adu_response;
-    std::vector<uint8_t> mbap_response_header(MBAP_HEADER_SIZE);
-    create_mbap_header(mbap_response_header, (uint16_t)pdu_response.size(), header_data.transaction_id, header_data.unit_id);
+/**
+ * @brief Lazy accessor over the big endian register payload of a read response
+ */
+class RegisterDataView {
+private:
+    std::span<const std::uint8_t> data_;
+
+public:
+    RegisterDataView() = default;
+    explicit RegisterDataView(std::span<const std::uint8_t> data) : data_(data) {}
+
+    size_t size() const { return data_.size() / 2; }
+    bool empty() const { return size() == 0; }
+    std::uint16_t operator[](size_t i) const { return from_big_endian(data_[i * 2], data_[i * 2 + 1]); }
+    std::span<const std::uint8_t> bytes() const { return data_; }
+
+    /**
+     * @brief Copy the registers (host endian) into a caller provided buffer
+     *
+     * @param out output buffer, at least size() elements
+     */
+    void copy_to(std::span<std::uint16_t> out) const {
+        simd::load_big_endian(data_, out.first(size()));
+    }
+};
 
-    adu_response.insert(adu_response.end(), mbap_response_header.begin(), mbap_response_header.end());
-    adu_response.insert(adu_response.end(), pdu_response.begin(), pdu_response.end());
+/**
+ * @brief Lazy accessor over the LSB first packed payload of a read bits response
+ */
+class BitDataView {
+private:
+    std::span<const std::uint8_t> data_;
+    size_t count_ = 0;
+
+public:
+    BitDataView() = default;
+    BitDataView(std::span<const std::uint8_t> data, size_t count)
+        : data_(data), count_(std::min(count, data.size() * 8)) {}
+
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    bool operator[](size_t i) const { return (data_[i / 8] >> (i % 8)) & 0x01; }
+    std::span<const std::uint8_t> bytes() const { return data_; }
+
+    /**
+     * @brief Expand the bits (one byte per bit) into a caller provided buffer
+     *
+     * @param out output buffer, at least size() elements
+     */
+    void copy_to(std::span<std::uint8_t> out) const {
+        simd::unpack_bits(data_, out.first(count_));
+    }
+};
 
-    return adu_response;
-}
+/**
+ * @brief Owning packed bitset (Modbus LSB-first layout), 2000 coils fit in 250 bytes
+ */
+class PackedBits {
+private:
+    std::vector<std::uint8_t> bytes_;
+    size_t count_ = 0;
+
+public:
+    PackedBits() = default;
+
+    /**
+     * @param bytes packed bits, unused bits of the last byte are cleared
+     * @param count number of bits
+     */
+    PackedBits(std::span<const std::uint8_t> bytes, size_t count)
+        : bytes_(bytes.begin(), bytes.begin() + (count + 7) / 8), count_(count) {
+        if (count_ % 8) {
+            bytes_.back() &= static_cast<std::uint8_t>((1 << (count_ % 8)) - 1);
+        }
+    }
+
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    bool operator[](size_t i) const { return (bytes_[i / 8] >> (i % 8)) & 0x01; }
+    std::span<const std::uint8_t> bytes() const { return bytes_; }
+    BitDataView view() const { return BitDataView(bytes_, count_); }
+
+    /**
+     * @brief Expand to one byte per bit
+     */
+    std::vector<std::uint8_t> unpack() const {
+        std::vector<std::uint8_t> bits(count_);
+        view().copy_to(bits);
+        return bits;
+    }
+
+    bool operator==(const PackedBits&) const = default;
+};
 
 /**
  * @brief Message header decoder
@@ -320,111 +1046,241 @@ inline std::vector<uint8_t> handle_read_registers(
  * @param buffer message buffer received
  * @return struct with header data
  */
-inline MbapHeader decode_header(const std::vector<std::uint8_t>& buffer) {
+inline MbapHeader decode_header(std::span<const std::uint8_t> buffer) {
+    return MbapHeaderView(buffer).header();
+}
+
+/**
+ * @brief Message header decoder without throwing
+ *
+ * @param buffer message buffer received
+ * @return struct with header data, or the reason the frame must be dropped
+ */
+inline std::expected<MbapHeader, DecodeError> try_decode_header(std::span<const std::uint8_t> buffer) {
     if (buffer.size() < MBAP_HEADER_SIZE)
-        throw std::runtime_error("MBAP header too short");
+        return std::unexpected(DecodeError::BufferTooShort);
+    if (from_big_endian(buffer[2], buffer[3]) != 0x0000)
+        return std::unexpected(DecodeError::InvalidProtocolId);
+    return MbapHeader{from_big_endian(buffer[0], buffer[1]), 0x0000, from_big_endian(buffer[4], buffer[5]), buffer[6]};
+}
 
-    MbapHeader header;
-    header.transaction_id = from_big_endian(buffer[0], buffer[1]);
-    header.protocol_id = from_big_endian(buffer[2], buffer[3]);
-    header.length = from_big_endian(buffer[4], buffer[5]);
-    header.unit_id = buffer[6];
+/**
+ * @brief Maximum quantity a read function code may request
+ *
+ * @param function_code function code number
+ * @return MAX_READ_BITS for coils/discrete inputs, MAX_READ_REGISTERS otherwise
+ */
+inline std::uint16_t max_read_quantity(std::uint8_t function_code) {
+    if (function_code == ReadCoils || function_code == ReadDiscreteInputs)
+        return MAX_READ_BITS;
+    return MAX_READ_REGISTERS;
+}
+
+/**
+ * @brief Byte count a write multiple request must carry for its quantity
+ *
+ * @param function_code WriteMultipleCoils or WriteMultipleRegisters
+ * @param quantity quantity of addresses
+ */
+inline size_t write_multiple_byte_count(std::uint8_t function_code, std::uint16_t quantity) {
+    if (function_code == WriteMultipleCoils)
+        return (quantity + 7) / 8;
+    return size_t{quantity} * 2;
+}
 
-    if (header.protocol_id != 0x0000) {
-        throw std::runtime_error("invalid Protocol ID");
+/**
+ * @brief Whether try_decode_request() decodes the function code
+ *
+ * @param function_code function code number
+ */
+inline bool is_supported_request(std::uint8_t function_code) {
+    switch (function_code) {
+        case ReadCoils:
+        case ReadDiscreteInputs:
+        case HoldingRegisters:
+        case InputRegisters:
+        case WriteSingleCoil:
+        case WriteSingleRegister:
+        case WriteMultipleCoils:
+        case WriteMultipleRegisters:
+        case ReadWriteMultipleRegisters:
+            return true;
+        default:
+            return false;
     }
-    return header;
 }
 
 /**
- * @brief Request message decoder
+ * @brief Request message decoder without throwing
  *
- * @param buffer message buffer received
- * @return struct with request data
+ * The function code is checked before the PDU length, so a short request for
+ * an unsupported function code (e.g. 0x11 Report Server ID) gets
+ * EXC_ILLEGAL_FUNCTION.
+ *
+ * @param buffer request PDU
+ * @return struct with request data, or the Modbus exception code to answer with
  */
-inline std::variant<modbus::RequestData, modbus::Exceptiondata> decode_request(const std::vector<std::uint8_t>& buffer) {
+inline std::expected<RequestData, std::uint8_t> try_decode_request(std::span<const std::uint8_t> buffer) {
+    if (buffer.empty() || !is_supported_request(buffer[0]))
+        return std::unexpected(EXC_ILLEGAL_FUNCTION);
     if (buffer.size() < 5)
-        throw std::runtime_error("EXC_ILLEGAL_BUFFER_SIZE");
+        return std::unexpected(EXC_ILLEGAL_DATA_VALUE);
 
-    uint16_t tmp_val{0};
+    PduView pdu(buffer);
 
     RequestData request;
-    request.func_code = buffer[0];
-    request.start_addr = from_big_endian(buffer[1], buffer[2]);
-
-    if (request.func_code < 0x01  && request.func_code > 0x06)
-        return Exceptiondata{EXC_ILLEGAL_FUNCTION, "EXC_ILLEGAL_FUNCTION"};
+    request.func_code = pdu.function_code();
+    request.start_addr = pdu.start_addr();
 
     switch (request.func_code) {
         case WriteSingleCoil:
             request.number = 0;
-            tmp_val = from_big_endian(buffer[3], buffer[4]);
-            request.value = (tmp_val ==0xFF00)? true : false;
+            request.value = (pdu.number() == 0xFF00)? true : false;
             break;
         case WriteSingleRegister:
             request.number = 0;
-            request.value = from_big_endian(buffer[3], buffer[4]);
+            request.value = pdu.number();
             break;
-        default:
-            request.number = from_big_endian(buffer[3], buffer[4]);
+        case WriteMultipleCoils:
+        case WriteMultipleRegisters:
+        {
+            request.number = pdu.number();
+            request.value = 0;
+            auto max_quantity = (request.func_code == WriteMultipleCoils) ? MAX_WRITE_BITS : MAX_WRITE_REGISTERS;
+            if (request.number == 0 || request.number > max_quantity || !pdu.has_write_payload() ||
+                pdu.write_byte_count() != write_multiple_byte_count(request.func_code, request.number))
+                return std::unexpected(EXC_ILLEGAL_DATA_VALUE);
+            request.payload = pdu.write_data();
+            break;
+        }
+        case ReadWriteMultipleRegisters:
+        {
+            request.number = pdu.number();
+            request.value = 0;
+            if (request.number == 0 || request.number > MAX_READ_REGISTERS || !pdu.has_read_write_payload())
+                return std::unexpected(EXC_ILLEGAL_DATA_VALUE);
+            request.write_addr = pdu.rw_write_addr();
+            request.write_number = pdu.rw_write_number();
+            if (request.write_number == 0 || request.write_number > MAX_READ_WRITE_REGISTERS ||
+                pdu.rw_byte_count() != request.write_number * 2)
+                return std::unexpected(EXC_ILLEGAL_DATA_VALUE);
+            request.payload = pdu.rw_write_data();
+            break;
+        }
+        case ReadCoils:
+        case ReadDiscreteInputs:
+        case HoldingRegisters:
+        case InputRegisters:
+            request.number = pdu.number();
             request.value = 0;
-            if (request.number == 0 || request.number > 2000)
-                return Exceptiondata{EXC_ILLEGAL_DATA_VALUE, "EXC_ILLEGAL_DATA_VALUE"};
+            if (request.number == 0 || request.number > max_read_quantity(request.func_code))
+                return std::unexpected(EXC_ILLEGAL_DATA_VALUE);
             break;
+        default:
+            return std::unexpected(EXC_ILLEGAL_FUNCTION);
     }
 
     return request;
 }
 
 /**
- * @brief Read coils message decoder
+ * @brief Request message decoder
  *
- * @param pdu_response message data buffer
- * @param quantity quantity of address to be processed
- * @return buffer with address data
+ * @param buffer message buffer received
+ * @return struct with request data
  */
-inline std::vector<uint8_t> decode_read_coils_response(
-        const std::vector<uint8_t>& pdu_response,
-        std::uint16_t quantity) {
+inline std::variant<modbus::RequestData, modbus::Exceptiondata> decode_request(std::span<const std::uint8_t> buffer) {
+    if (buffer.size() < 5)
+        throw std::runtime_error("EXC_ILLEGAL_BUFFER_SIZE");
 
-    std::vector<uint8_t> response;
+    auto request = try_decode_request(buffer);
+    if (!request)
+        return Exceptiondata{request.error(), std::string(exception_name(request.error()))};
+    return *request;
+}
 
-    uint8_t function_code = pdu_response[0];
+/**
+ * @brief Validate a read response PDU and return a view over its payload
+ *
+ * @param pdu_response response PDU
+ * @param fc_a accepted function code
+ * @param fc_b accepted function code
+ * @return view over the validated PDU
+ */
+inline PduView check_read_response(std::span<const std::uint8_t> pdu_response, std::uint8_t fc_a, std::uint8_t fc_b) {
+    PduView pdu(pdu_response);
 
-    if (function_code & 0x80) {
-        uint8_t exception_code = pdu_response[1];
-        std::string error_msg = "Exception FC: " + std::to_string(function_code & 0x7F) +
-                                ", exception_code: " + std::to_string(exception_code);
+    if (pdu.is_exception()) {
+        std::string error_msg = "Exception FC: " + std::to_string(pdu.function_code() & 0x7F) +
+                                ", exception_code: " + std::to_string(pdu.exception_code());
         throw std::runtime_error(error_msg);
     }
 
-    if (function_code != modbus::FunctionCode::ReadCoils &&
-        function_code != modbus::FunctionCode::ReadDiscreteInputs) {
-        throw std::runtime_error("Exception invalid FC: " + std::to_string(function_code));
+    if (pdu.function_code() != fc_a && pdu.function_code() != fc_b) {
+        throw std::runtime_error("Exception invalid FC: " + std::to_string(pdu.function_code()));
     }
 
-    // Byte Count (Byte 8)
-    uint8_t byte_count = pdu_response[1];
-
     // Check if the total length matches the expected length.
-    if (pdu_response.size() != (1 + 1 + byte_count)) {
-        throw std::runtime_error("Exception Invalid Byte Count:" + std::to_string(byte_count));
+    if (!pdu.has_valid_byte_count()) {
+        throw std::runtime_error("Exception Invalid Byte Count:" + std::to_string(pdu.byte_count()));
     }
+    return pdu;
+}
 
-    // Data decoder
-    for (int i = 0; i < byte_count; ++i) {
-        uint8_t current_byte = pdu_response[2 + i];
-
-        // Each byte contains 8 coils (bits). The LSB (bit 0) is the first coil read.
-        for (int bit = 0; bit < 8; ++bit) {
-            // Extracts the bit value (true if it's 1, false if it's 0)
-            bool coil_value = (current_byte >> bit) & 0x01;
-            if(quantity>0) {
-                response.push_back(coil_value);
-                quantity--;
-            }
-        }
-    }
+/**
+ * @brief Read coils message decoder returning a view over the response buffer
+ *
+ * @param pdu_response message data buffer
+ * @param quantity quantity of address to be processed
+ * @return view over the packed coils
+ */
+inline BitDataView decode_read_coils_view(
+        std::span<const std::uint8_t> pdu_response,
+        std::uint16_t quantity) {
+    auto pdu = check_read_response(pdu_response, FunctionCode::ReadCoils, FunctionCode::ReadDiscreteInputs);
+    if (pdu.byte_count() != (quantity + 7) / 8) throw std::runtime_error("read response quantity mismatch");
+    return BitDataView(pdu.data(), quantity);
+}
+
+/**
+ * @brief Read coils message decoder keeping the bits packed
+ *
+ * @param pdu_response message data buffer
+ * @param quantity quantity of bits requested
+ * @return packed copy of the bits
+ */
+inline PackedBits decode_read_coils_packed(
+        std::span<const std::uint8_t> pdu_response,
+        std::uint16_t quantity) {
+    auto bits = decode_read_coils_view(pdu_response, quantity);
+    return PackedBits(bits.bytes(), bits.size());
+}
+
+/**
+ * @brief Read register message decoder returning a view over the response buffer
+ *
+ * @param pdu_response message data buffer
+ * @return view over the big endian registers
+ */
+inline RegisterDataView decode_read_register_view(std::span<const std::uint8_t> pdu_response) {
+    auto pdu = check_read_response(pdu_response, FunctionCode::HoldingRegisters, FunctionCode::InputRegisters);
+    return RegisterDataView(pdu.data());
+}
+
+/**
+ * @brief Read coils message decoder
+ *
+ * @param pdu_response message data buffer
+ * @param quantity quantity of address to be processed
+ * @return buffer with address data
+ */
+inline std::vector<uint8_t> decode_read_coils_response(
+        std::span<const std::uint8_t> pdu_response,
+        std::uint16_t quantity) {
+
+    auto bits = decode_read_coils_view(pdu_response, quantity);
+    std::vector<uint8_t> response(bits.size());
+    bits.copy_to(response);
     return response;
 }
 
@@ -436,82 +1292,248 @@ inline std::vector<uint8_t> decode_read_coils_response(
  * @return buffer with address data
  */
 inline std::vector<uint16_t> decode_read_register_response(
-        const std::vector<uint8_t>& pdu_response,
+        std::span<const std::uint8_t> pdu_response,
         std::uint16_t quantity) {
 
-    std::vector<uint16_t> response;
+    auto registers = decode_read_register_view(pdu_response);
+    if (registers.size() != quantity) throw std::runtime_error("read response quantity mismatch");
+    std::vector<uint16_t> response(registers.size());
+    registers.copy_to(response);
+    return response;
+}
 
-    uint8_t function_code = pdu_response[0];
+/**
+ * @brief Read response decoder for FC 0x01 - 0x04 and 0x17
+ *
+ * @param pdu_response message data buffer
+ * @param quantity quantity of address requested
+ * @param function_code function code requested
+ * @return coils (one byte per coil) or registers
+ */
+inline std::variant<std::vector<uint8_t>, std::vector<uint16_t>> decode_read_data_response(
+        std::span<const std::uint8_t> pdu_response,
+        std::uint16_t quantity,
+        FunctionCode function_code) {
+
+    switch (function_code) {
+        case FunctionCode::ReadCoils:
+        case FunctionCode::ReadDiscreteInputs:
+        {
+            auto bits = decode_read_coils_view(pdu_response, quantity);
+            std::vector<uint8_t> data_response(bits.size());
+            bits.copy_to(data_response);
+            return data_response;
+        }
+        case FunctionCode::HoldingRegisters:
+        case FunctionCode::InputRegisters:
+        {
+            auto registers = decode_read_register_view(pdu_response);
+            if (registers.size() != quantity) throw std::runtime_error("read response quantity mismatch");
+            std::vector<uint16_t> data_response(registers.size());
+            registers.copy_to(data_response);
+            return data_response;
+        }
+        case FunctionCode::ReadWriteMultipleRegisters:
+        {
+            RegisterDataView registers(check_read_response(pdu_response, function_code, function_code).data());
+            if (registers.size() != quantity) throw std::runtime_error("read response quantity mismatch");
+            std::vector<uint16_t> data_response(registers.size());
+            registers.copy_to(data_response);
+            return data_response;
+        }
+        default:
+            throw std::runtime_error("Function Code " + std::to_string(function_code) + " nnot supported");
+    }
+}
 
-    if (function_code & 0x80) {
-        uint8_t exception_code = pdu_response[1];
-        std::string error_msg = "Exception FC: " + std::to_string(function_code & 0x7F) +
-                                ", exception_code: " + std::to_string(exception_code);
-        throw std::runtime_error(error_msg);
+/**
+ * @brief Reassemble the responses of create_read_requests() into one contiguous result
+ *
+ * @param requests requests as built by create_read_requests()
+ * @param responses response ADUs, in request order
+ * @param function_code function code requested
+ * @return coils (one byte per coil) or registers
+ */
+inline std::variant<std::vector<uint8_t>, std::vector<uint16_t>> decode_read_responses(
+        const std::vector<std::vector<std::uint8_t>>& requests,
+        const std::vector<std::vector<std::uint8_t>>& responses,
+        FunctionCode function_code) {
+
+    std::variant<std::vector<uint8_t>, std::vector<uint16_t>> result;
+    if (function_code != ReadCoils && function_code != ReadDiscreteInputs) {
+        result = std::vector<uint16_t>();
     }
 
-    if (function_code != modbus::FunctionCode::HoldingRegisters &&
-        function_code != modbus::FunctionCode::InputRegisters) {
-        throw std::runtime_error("Exception invalid FC: " + std::to_string(function_code));
+    for (size_t i = 0; i < requests.size(); ++i) {
+        MbapHeaderView request(requests[i]);
+        MbapHeaderView response(responses.at(i));
+        if (response.unit_id() != request.unit_id()) throw std::runtime_error("Invalid UNIT_ID");
+
+        auto quantity = PduView(request.pdu()).number();
+        auto part = decode_read_data_response(response.pdu(), quantity, function_code);
+        std::visit([&](auto& data) {
+            // A short chunk would shift every following address.
+            if (data.size() != quantity) throw std::runtime_error("read response quantity mismatch");
+            auto& all = std::get<std::decay_t<decltype(data)>>(result);
+            all.insert(all.end(), data.begin(), data.end());
+        }, part);
     }
+    return result;
+}
 
-    // Byte Count (Byte 8)
-    uint8_t byte_count = pdu_response[1];
+/**
+ * @brief Reassemble the bit responses of create_read_requests() keeping them packed
+ *
+ * @param requests requests as built by create_read_requests()
+ * @param responses response ADUs, in request order
+ * @return packed bits
+ */
+inline PackedBits decode_read_packed_responses(
+        const std::vector<std::vector<std::uint8_t>>& requests,
+        const std::vector<std::vector<std::uint8_t>>& responses) {
+
+    // Every chunk but the last holds MAX_READ_BITS, so the chunks join on byte boundaries.
+    static_assert(MAX_READ_BITS % 8 == 0);
+
+    std::vector<std::uint8_t> bytes;
+    size_t count = 0;
+    for (size_t i = 0; i < requests.size(); ++i) {
+        MbapHeaderView request(requests[i]);
+        MbapHeaderView response(responses.at(i));
+        if (response.unit_id() != request.unit_id()) throw std::runtime_error("Invalid UNIT_ID");
+
+        auto part = decode_read_coils_packed(response.pdu(), PduView(request.pdu()).number());
+        bytes.insert(bytes.end(), part.bytes().begin(), part.bytes().end());
+        count += part.size();
+    }
+    return PackedBits(bytes, count);
+}
 
-    auto data_offset = 2;
+/**
+ * @brief Write response checker for FC 0x05 - 0x06
+ *
+ * @param pdu_response message data buffer
+ * @param address address requested
+ * @param value value requested
+ */
+inline void check_write_response(
+        std::span<const std::uint8_t> pdu_response,
+        std::uint16_t address,
+        std::uint16_t value) {
+
+    PduView pdu(pdu_response);
+    if (pdu.is_exception()) {
+        throw std::runtime_error("Exception FC: " + std::to_string(pdu.function_code() & 0x7F) +
+                                 ", exception_code: " + std::to_string(pdu.exception_code()));
+    }
 
-    // Check if the total length matches the expected length.
-    if (pdu_response.size() != (data_offset + byte_count)) {
-        throw std::runtime_error("Exception Invalid Byte Count:" + std::to_string(byte_count));
+    auto data = decode_request(pdu_response);
+    if (std::holds_alternative<Exceptiondata>(data)) {
+        throw std::runtime_error(std::get<Exceptiondata>(data).name);
     }
 
-    // 2 bytes data size (uint16_t)
-    size_t num_registers = byte_count / 2;
+    auto response = std::get<RequestData>(data);
+    if (response.start_addr != address) throw std::runtime_error("Invalid START_ADDR");
+    if (response.value != value) throw std::runtime_error("Invalid VALUE");
+}
+
+/**
+ * @brief Write response checker for FC 0x0F - 0x10
+ *
+ * @param pdu_response message data buffer
+ * @param function_code function code requested
+ * @param address start address requested
+ * @param quantity quantity requested
+ */
+inline void check_write_multiple_response(
+        std::span<const std::uint8_t> pdu_response,
+        std::uint8_t function_code,
+        std::uint16_t address,
+        std::uint16_t quantity) {
 
-    for (size_t i = 0; i < num_registers; ++i) {
-        const uint8_t* register_data = pdu_response.data() + data_offset + (i * 2);
-        uint16_t reg_value = from_big_endian(register_data[0], register_data[1]);
-        response.push_back(reg_value);
+    PduView pdu(pdu_response);
+    if (pdu.is_exception()) {
+        throw std::runtime_error("Exception FC: " + std::to_string(pdu.function_code() & 0x7F) +
+                                 ", exception_code: " + std::to_string(pdu.exception_code()));
     }
-    return response;
+    if (pdu.function_code() != function_code) throw std::runtime_error("Exception invalid FC: " + std::to_string(pdu.function_code()));
+    if (!pdu.has_address_fields()) throw std::runtime_error("PDU too short");
+    if (pdu.start_addr() != address) throw std::runtime_error("Invalid START_ADDR");
+    if (pdu.number() != quantity) throw std::runtime_error("Invalid QUANTITY");
 }
 
 /**
- * @brief Build the Exception PDU
+ * @brief Encode the Exception ADU into a caller provided buffer
  *
+ * @param adu output buffer
  * @param header_data message header buffer
- * @param requested_fc function code number
+ * @param requested_fc function code of the request
  * @param exception_code exception code number
- * @return response message buffer with the exception number
+ * @return number of bytes written
  */
-std::vector<uint8_t> create_modbus_exception_adu(
+inline size_t encode_exception_adu(
+    std::span<std::uint8_t> adu,
     const MbapHeader header_data,
-    Exceptiondata exception_code)
+    std::uint8_t requested_fc,
+    std::uint8_t exception_code)
 {
-    std::vector<uint8_t> pdu_exception;
-
-    // Exception Function Code = Default FC + 0x80
-    uint8_t exception_fc = 0x01 | 0x80;
-    pdu_exception.push_back(exception_fc);
-
-    // Exception Code
-    pdu_exception.push_back(exception_code.code);
-
     // The exception PDU is always 2 bytes long.
-    // The Modbus/TCP length is PDU size (2)
-    uint16_t new_length = 2;
+    const std::uint16_t pdu_size = 2;
+    check_adu_capacity(adu, MBAP_HEADER_SIZE + pdu_size);
+    encode_mbap_header(adu, pdu_size, header_data.transaction_id, header_data.unit_id);
 
-     std::vector<uint8_t> mbap_response_header(MBAP_HEADER_SIZE);
-    create_mbap_header(mbap_response_header, (uint16_t)new_length, header_data.transaction_id, header_data.unit_id);
+    // Exception Function Code = Requested FC + 0x80
+    adu[7] = requested_fc | 0x80;
 
-    std::vector<uint8_t> adu_response;
-    adu_response.reserve(mbap_response_header.size() + pdu_exception.size());
+    // Exception Code
+    adu[8] = exception_code;
 
     // ADU = MBAP Header (7 bytes) + Exception PDU (2 bytes) = 9 bytes
-    adu_response.insert(adu_response.end(), mbap_response_header.begin(), mbap_response_header.end());
-    adu_response.insert(adu_response.end(), pdu_exception.begin(), pdu_exception.end());
+    return MBAP_HEADER_SIZE + pdu_size;
+}
+
+inline size_t encode_exception_adu(
+    std::span<std::uint8_t> adu,
+    const MbapHeader header_data,
+    std::uint8_t requested_fc,
+    const Exceptiondata& exception_code)
+{
+    return encode_exception_adu(adu, header_data, requested_fc, exception_code.code);
+}
 
+/**
+ * @brief Build the Exception PDU
+ *
+ * @param header_data message header buffer
+ * @param requested_fc function code number
+ * @param exception_code exception code number
+ * @return response message buffer with the exception number
+ */
+inline std::vector<uint8_t> create_modbus_exception_adu(
+    const MbapHeader header_data,
+    std::uint8_t requested_fc,
+    Exceptiondata exception_code)
+{
+    std::vector<uint8_t> adu_response(MBAP_HEADER_SIZE + 2);
+    encode_exception_adu(adu_response, header_data, requested_fc, exception_code);
     return adu_response;
 }
 
+/**
+ * @brief Build the Exception ADU of a Read Coils request
+ *
+ * MbapHeader does not carry the function code, prefer the overload taking the
+ * requested function code.
+ *
+ * @param header_data message header buffer
+ * @param exception_code exception code number
+ * @return response message buffer with the exception number
+ */
+inline std::vector<uint8_t> create_modbus_exception_adu(
+    const MbapHeader header_data,
+    Exceptiondata exception_code)
+{
+    return create_modbus_exception_adu(header_data, FunctionCode::ReadCoils, exception_code);
+}
+
 } // namespace modbus
\ No newline at end of file
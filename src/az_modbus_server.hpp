@@ -2,110 +2,274 @@
 
 #include "az_modbus_server_transport_awaitable.hpp"
 #include "az_modbus_protocol.hpp"
+#include "az_modbus_frame_parser.hpp"
 #include "az_database_interface.hpp"
+#include "az_response_cache.hpp"
+#include "az_write_subscription.hpp"
 #include "az_helper.hpp"
 #include <stdexcept>
 #include <memory>
+#include <expected>
+#include <optional>
 
 namespace modbus {
 
 class ModbusServer {
 private:
+    // Responses held before they are flushed, bounds the work done per read
+    // when a client pipelines requests.
+    static constexpr size_t MAX_BATCHED_RESPONSES = 32;
+
     std::unique_ptr<IServerTransport> transport_;
-    std::unique_ptr<db::DatabaseInterface> database_;
-    modbus::UnitID unit_id_{0};
+    std::vector<std::unique_ptr<db::DatabaseInterface>> databases_;
+    // Database of every unit ID, nullptr for units not served. Read without a lock, only changed before start().
+    std::array<db::DatabaseInterface*, MAX_UNIT_IDS> units_{};
+    bool started_ = false;
+    // Read responses shared by all connections, nullptr unless enable_response_cache() was called.
+    std::unique_ptr<ResponseCache> cache_;
+    // Write subscribers, only changed before start().
+    std::vector<std::shared_ptr<WriteSubscription>> subscriptions_;
+
+    /**
+     * @brief Per-connection response storage
+     *
+     * Read data is produced in place in payload (registers are converted to big
+     * endian there) and frame refers to it, so nothing is copied again before the
+     * gather write.
+     */
+    struct ResponseBuffer {
+        modbus::ResponseFrame frame;
+        alignas(8) std::array<std::uint16_t, MAX_READ_REGISTERS> payload;
+
+        std::span<std::uint8_t> payload_bytes(size_t size) {
+            return std::span<std::uint8_t>(reinterpret_cast<std::uint8_t*>(payload.data()), size);
+        }
+    };
+
+    // Generation to validate a cached response against, nullopt when the response is not cached.
+    std::optional<std::uint64_t> cache_generation(db::DatabaseInterface& database, db::DbType type) const {
+        if (!cache_) return std::nullopt;
+        return database.db_generation(type);
+    }
+
+    // Reports a write applied to the database to the subscribers.
+    void notify_write(std::uint8_t unit_id, db::DbType type, std::uint16_t start, size_t count) {
+        for (const auto& subscription : subscriptions_) {
+            subscription->publish(unit_id, type, start, count);
+        }
+    }
+
+    static modbus::ResponseCacheKey cache_key(const modbus::MbapHeader& header, const modbus::RequestData& request) {
+        return {header.unit_id, request.func_code, request.start_addr, request.number};
+    }
+
+    size_t encode_exception(modbus::ResponseFrame& response, const modbus::MbapHeader& header,
+        std::uint8_t function_code, std::uint8_t exception_code) {
+        std::cerr << "[SERVER] Exception response: [" << static_cast<int>(exception_code) << "] "
+                  << modbus::exception_name(exception_code) << '\n';
+        response.payload = {};
+        response.header_size = modbus::encode_exception_adu(response.header, header, function_code, exception_code);
+        return response.size();
+    }
+
+    /**
+     * @brief Decode one request ADU and encode its response ADU
+     *
+     * Malformed requests are answered with a Modbus exception ADU, requests for
+     * a unit that is not served with EXC_GATEWAY_TARGET_FAILED.
+     *
+     * @param frame request ADU, its MBAP header already checked by the FrameParser
+     * @param buffer connection storage receiving the response
+     * @return response size
+     */
+    size_t handle_frame(std::span<const std::uint8_t> frame, ResponseBuffer& buffer) {
+        helper::print_hex_buffer(frame, "<<<< frame: ");
+
+        const auto header = modbus::decode_header(frame);
+        auto& response = buffer.frame;
+        response.payload = {};
+        auto pdu_data = frame.subspan(MBAP_HEADER_SIZE);
+        std::uint8_t function_code = pdu_data.empty() ? 0 : pdu_data[0];
+
+        db::DatabaseInterface* database = units_[header.unit_id];
+        if (!database) return encode_exception(response, header, function_code, EXC_GATEWAY_TARGET_FAILED);
+
+        auto data = modbus::try_decode_request(pdu_data);
+        if (!data) return encode_exception(response, header, function_code, data.error());
+
+        const auto& request = *data;
+
+        std::cout
+        << "PDU FC=0x"
+        << std::hex
+        << static_cast<int>(request.func_code)
+        << std::dec
+        << " Start Addr:"
+        << request.start_addr
+        << " Number:"
+        << request.number
+        << " Value:"
+        << request.value
+        << "\n";
+
+        bool in_range = true;
+
+        std::uint16_t start = static_cast<std::uint16_t>(request.start_addr - 1);
+        switch (request.func_code) {
+            case ReadCoils:
+            case ReadDiscreteInputs:
+            {
+                auto type = (request.func_code == ReadCoils) ? db::DbType::BITS : db::DbType::BITS_INPUT;
+                // Read before the data, so a write racing with the read leaves an entry that never hits.
+                auto generation = cache_generation(*database, type);
+                if (generation && cache_->lookup(cache_key(header, request), *generation, header.transaction_id,
+                        response, buffer.payload_bytes(sizeof(buffer.payload)))) break;
+
+                // The packed bits are read straight into the payload.
+                auto packed = buffer.payload_bytes((request.number + 7) / 8);
+                in_range = database->db_read_bits(type, start, request.number, packed);
+                modbus::encode_read_response_frame(response, header, request.func_code, packed);
+                if (generation && in_range) cache_->insert(cache_key(header, request), *generation, response);
+                break;
+            }
+            case HoldingRegisters:
+            case InputRegisters:
+            {
+                auto type = (request.func_code == HoldingRegisters) ? db::DbType::REGISTER : db::DbType::REGISTER_INPUT;
+                auto generation = cache_generation(*database, type);
+                if (generation && cache_->lookup(cache_key(header, request), *generation, header.transaction_id,
+                        response, buffer.payload_bytes(sizeof(buffer.payload)))) break;
+
+                // Registers are read into the payload and swapped to big endian in place.
+                auto values = std::span<std::uint16_t>(buffer.payload).first(request.number);
+                in_range = database->db_read_range(type, start, values);
+                modbus::encode_read_response_frame(response, header, request.func_code, simd::to_big_endian_in_place(values));
+                if (generation && in_range) cache_->insert(cache_key(header, request), *generation, response);
+                break;
+            }
+            case WriteSingleCoil:
+            {
+                std::uint8_t bit = static_cast<std::uint8_t>(request.value);
+                in_range = database->db_write_bits(db::DbType::BITS, start, 1, std::span<const std::uint8_t>(&bit, 1));
+                if (in_range) notify_write(header.unit_id, db::DbType::BITS, start, 1);
+                response.header_size = modbus::encode_write_adu(response.header, header.transaction_id, header.unit_id, request.start_addr, request.value, FunctionCode::WriteSingleCoil);
+                break;
+            }
+            case WriteSingleRegister:
+            {
+                std::uint16_t value = request.value;
+                in_range = database->db_write_range(db::DbType::REGISTER, start, std::span<const std::uint16_t>(&value, 1));
+                if (in_range) notify_write(header.unit_id, db::DbType::REGISTER, start, 1);
+                response.header_size = modbus::encode_write_adu(response.header, header.transaction_id, header.unit_id, request.start_addr, request.value, FunctionCode::WriteSingleRegister);
+                break;
+            }
+            case WriteMultipleCoils:
+            {
+                in_range = database->db_write_bits(db::DbType::BITS, start, request.number, request.payload);
+                if (in_range) notify_write(header.unit_id, db::DbType::BITS, start, request.number);
+                response.header_size = modbus::encode_write_multiple_response(response.header, header, request);
+                break;
+            }
+            case WriteMultipleRegisters:
+            {
+                std::array<std::uint16_t, MAX_WRITE_REGISTERS> registers;
+                auto values = std::span<std::uint16_t>(registers).first(request.number);
+                simd::load_big_endian(request.payload, values);
+                in_range = database->db_write_range(db::DbType::REGISTER, start, values);
+                if (in_range) notify_write(header.unit_id, db::DbType::REGISTER, start, values.size());
+                response.header_size = modbus::encode_write_multiple_response(response.header, header, request);
+                break;
+            }
+            case ReadWriteMultipleRegisters:
+            {
+                // Both ranges are checked against the address space before anything is written, so
+                // an exception never leaves a write behind in a database covering the whole space.
+                auto write_start = static_cast<std::uint16_t>(request.write_addr - 1);
+                in_range = size_t{start} + request.number <= 0x10000 && size_t{write_start} + request.write_number <= 0x10000;
+                if (!in_range) break;
+
+                std::array<std::uint16_t, MAX_READ_WRITE_REGISTERS> registers;
+                auto written = std::span<std::uint16_t>(registers).first(request.write_number);
+                simd::load_big_endian(request.payload, written);
+                in_range = database->db_write_range(db::DbType::REGISTER, write_start, written);
+                if (!in_range) break;
+                notify_write(header.unit_id, db::DbType::REGISTER, write_start, written.size());
 
+                // The write is applied before the read.
+                auto values = std::span<std::uint16_t>(buffer.payload).first(request.number);
+                in_range = database->db_read_range(db::DbType::REGISTER, start, values);
+                modbus::encode_read_response_frame(response, header, request.func_code, simd::to_big_endian_in_place(values));
+                break;
+            }
+            default:
+                return encode_exception(response, header, function_code, EXC_ILLEGAL_FUNCTION);
+        }
+
+        if (!in_range) {
+            return encode_exception(response, header, function_code, EXC_ILLEGAL_DATA_ADDRESS);
+        }
+        return response.size();
+    }
+
+    // Sends the responses with one gather write.
+    static asio::awaitable<void> flush_responses(IModbusChannel& channel, std::span<const ResponseBuffer> responses,
+        std::vector<asio::const_buffer>& buffers) {
+        buffers.clear();
+        for (const auto& response : responses) {
+            const auto& out = response.frame;
+            helper::print_hex_buffer(out.header_bytes(), ">>>> header: ");
+            buffers.push_back(asio::buffer(out.header.data(), out.header_size));
+            if (!out.payload.empty()) {
+                helper::print_hex_buffer(out.payload, ">>>> payload: ");
+                buffers.push_back(asio::buffer(out.payload.data(), out.payload.size()));
+            }
+        }
+        co_await channel.co_write(std::span<const asio::const_buffer>(buffers));
+    }
+
+    /**
+     * @brief Request loop of one connection
+     *
+     * Every complete request already received is served in order and the
+     * responses are flushed together, so a pipelining client gets one write per
+     * read instead of one per request. At most MAX_BATCHED_RESPONSES responses
+     * are held; when the limit is reached they are flushed before more
+     * requests are served, and nothing more is read from the socket until the
+     * flush completes.
+     */
     asio::awaitable<void> do_modbus_loop(std::unique_ptr<IModbusChannel> channel) {
         try {
-            while (true) {
-                std::vector<std::uint8_t> adu_buffer;
+            modbus::FrameParser parser;
+            std::vector<ResponseBuffer> responses(MAX_BATCHED_RESPONSES);
+            std::vector<asio::const_buffer> buffers;
+            buffers.reserve(2 * MAX_BATCHED_RESPONSES);
 
+            while (true) {
                 std::cout << "[SERVER] Waiting for connection" << std::endl;
 
-                auto header_buffer = co_await channel->co_read(MBAP_HEADER_SIZE);
-
-                helper::print_hex_buffer(header_buffer, "<<<< header: ");
-
-                auto header = modbus::decode_header(header_buffer);
-                if (header.unit_id != unit_id_.value) throw std::runtime_error("invalid UNIT_ID");
-
-                size_t pdu_size = header.length - 1;
-                auto pdu_data = co_await channel->co_read(pdu_size);
-
-                helper::print_hex_buffer(pdu_data, "<<<< pdu_data: ");
-
-                auto data = decode_request(pdu_data);
-
-                if (std::holds_alternative<modbus::RequestData>(data)) {
-
-                    auto request = std::get<modbus::RequestData>(data);
-
-                    std::cout
-                    << "PDU FC=0x"
-                    << std::hex
-                    << static_cast<int>(request.func_code)
-                    << std::dec
-                    << " Start Addr:"
-                    << request.start_addr
-                    << " Number:"
-                    << request.number
-                    << " Value:"
-                    << request.value
-                    << "\n";
-
-                    std::vector<std::uint8_t> dados_bit;
-                    std::vector<std::uint16_t> dados_reg;
-
-                    auto start = request.start_addr - 1;
-                    auto stop = start + request.number;
-                    switch (request.func_code) {
-                        case ReadCoils:
-                            for(std::uint16_t id=start; id < stop; id++) {
-                                auto ret = std::get<uint8_t>(database_->db_read(db::DbType::BITS, id));
-                                dados_bit.push_back(ret);
-                            }
-                            adu_buffer = modbus::handle_read_bits(header, request, dados_bit);
-                            break;
-                        case ReadDiscreteInputs:
-                            for(std::uint16_t id=start; id < stop; id++) {
-                                database_->db_update(db::DbType::BITS_INPUT, id, static_cast<std::uint8_t>(id%2 ? 1: 0)); //input simulation
-                                dados_bit.push_back(std::get<uint8_t>(database_->db_read(db::DbType::BITS_INPUT, id)));
-                            }
-                            adu_buffer = modbus::handle_read_bits(header, request, dados_bit);
-                            break;
-                        case HoldingRegisters:
-                            for(std::uint16_t id=start; id < stop; id++) {
-                                dados_reg.push_back(std::get<uint16_t>(database_->db_read(db::DbType::REGISTER, id)));
-                            }
-                            adu_buffer = modbus::handle_read_registers(header, request, dados_reg);
-                            break;
-                        case InputRegisters:
-                            for(std::uint16_t id=start; id < stop; id++) {
-                                database_->db_update(db::DbType::REGISTER_INPUT, id, static_cast<std::uint16_t>(id%2 ? 1: 0)); //input simulation
-                                dados_reg.push_back(std::get<uint16_t>(database_->db_read(db::DbType::REGISTER_INPUT, id)));
-                            }
-                            adu_buffer = modbus::handle_read_registers(header, request, dados_reg);
-                            break;
-                        case WriteSingleCoil:
-                            database_->db_update(db::DbType::BITS, start, static_cast<std::uint8_t>(request.value));
-                            adu_buffer = modbus::create_write_adu(header.transaction_id, header.unit_id, request.start_addr, request.value, FunctionCode::WriteSingleCoil);
-                            break;
-                        case WriteSingleRegister:
-                            database_->db_update(db::DbType::REGISTER, start, static_cast<std::uint16_t>(request.value));
-                            adu_buffer = modbus::create_write_adu(header.transaction_id, header.unit_id, request.start_addr, request.value, FunctionCode::WriteSingleRegister);
-                            break;
-                        default:
-                            throw std::runtime_error("Modbus Exception: " + std::to_string(request.func_code));
-                            break;
+                // One read may carry a partial frame or several pipelined frames.
+                auto received = co_await channel->co_read_some(parser.prepare());
+                parser.commit(received);
+
+                size_t pending = 0;
+                auto frame = parser.try_next_frame();
+                for (; frame && *frame; frame = parser.try_next_frame()) {
+                    handle_frame(**frame, responses[pending]);
+                    if (++pending == responses.size()) {
+                        co_await flush_responses(*channel, responses, buffers);
+                        pending = 0;
                     }
                 }
-                else {
-                    auto exception = std::get<modbus::Exceptiondata>(data);
-                    std::cerr << "[SERVER] Exception response: [" << static_cast<int>(exception.code) << "] " << exception.name << std::endl;
-                    adu_buffer = modbus::create_modbus_exception_adu(header, exception);
+                if (pending > 0) {
+                    co_await flush_responses(*channel, std::span<const ResponseBuffer>(responses).first(pending), buffers);
+                }
+
+                // The frame boundaries are lost, the requests before the bad header are still answered.
+                if (!frame) {
+                    std::cerr << "[SERVER] Connection closed, corrupted stream: " << modbus::decode_error_name(frame.error()) << '\n';
+                    channel->close();
+                    co_return;
                 }
-                helper::print_hex_buffer(adu_buffer, ">>>> adu_buffer: ");
-                co_await channel->co_write(adu_buffer);
             }
         } catch (const std::exception& e) {
             std::cerr << "[SERVER] Connection closed, error: " << e.what() << std::endl;
@@ -125,14 +289,102 @@ private:
     }
 
 public:
+    /**
+     * @brief Server without units, add them with add_unit() before start()
+     *
+     * @param transport server transport accepting the connections
+     */
+    explicit ModbusServer(std::unique_ptr<IServerTransport> transport)
+        : transport_(std::move(transport)) {}
+
+    /**
+     * @param transport server transport accepting the connections
+     * @param database tables shared by every connection, must be thread safe when the
+     *        transport runs on a ModbusContext with more than one thread (e.g. db::RegisterBank)
+     * @param unit_id unit served by this server
+     */
     ModbusServer(std::unique_ptr<IServerTransport> transport,
         std::unique_ptr<db::DatabaseInterface> database,
         modbus::UnitID unit_id)
-        : transport_(std::move(transport)),
-        database_(std::move(database)),
-        unit_id_(unit_id) {}
+        : transport_(std::move(transport)) {
+        add_unit(unit_id, std::move(database));
+    }
+
+    /**
+     * @brief Serve one more unit ID from its own database
+     *
+     * Requests are routed by the MBAP unit ID with a table lookup. Units that
+     * are not registered get EXC_GATEWAY_TARGET_FAILED (0x0B).
+     *
+     * @param unit_id unit ID (1 - 247 for addressable slaves; 0 and 255 are accepted for direct TCP servers)
+     * @param database tables of this unit, same thread safety requirement as the constructor's
+     */
+    void add_unit(modbus::UnitID unit_id, std::unique_ptr<db::DatabaseInterface> database) {
+        if (started_) throw std::runtime_error("units must be added before start()");
+        if (unit_id.value >= MAX_UNIT_IDS) throw std::runtime_error("invalid UNIT_ID");
+        if (!database) throw std::runtime_error("null database");
+        if (units_[unit_id.value]) throw std::runtime_error("UNIT_ID " + std::to_string(unit_id.value) + " already served");
+
+        units_[unit_id.value] = database.get();
+        databases_.push_back(std::move(database));
+    }
+
+    /**
+     * @brief Cache read responses (FC 0x01 - 0x04) shared by every connection
+     *
+     * Entries are keyed by (unit, FC, start, quantity) and validated against the
+     * write generation of the table (DatabaseInterface::db_generation), so any
+     * write to the table, through Modbus or directly to the database, makes them
+     * miss. Units whose database does not track generations are never cached.
+     *
+     * @param slots number of cached responses, rounded up to a power of two
+     */
+    void enable_response_cache(size_t slots = ResponseCache::DEFAULT_SLOTS) {
+        if (started_) throw std::runtime_error("the response cache must be enabled before start()");
+        cache_ = std::make_unique<ResponseCache>(slots);
+    }
+
+    /**
+     * @brief Be notified of master writes to an address range
+     *
+     * Writes of FC 0x05, 0x06, 0x0F, 0x10 and 0x17 that reach the database are
+     * published to the subscription from the I/O threads without a lock;
+     * collect them with WriteSubscription::drain() from one consumer thread.
+     *
+     * @param unit_id unit whose writes are reported
+     * @param type db::DbType::BITS (coils) or db::DbType::REGISTER (holding registers)
+     * @param start first database address (request address minus one)
+     * @param count number of addresses
+     * @param capacity events queued between two drain() calls before the subscription overflows
+     * @return the subscription, shared with the server
+     */
+    std::shared_ptr<WriteSubscription> subscribe_writes(modbus::UnitID unit_id, db::DbType type,
+        std::uint16_t start, std::uint32_t count, size_t capacity = 1024) {
+        if (started_) throw std::runtime_error("subscriptions must be added before start()");
+        if (unit_id.value >= MAX_UNIT_IDS) throw std::runtime_error("invalid UNIT_ID");
+        if (type != db::DbType::BITS && type != db::DbType::REGISTER) throw std::runtime_error("only coils and holding registers are written by masters");
+
+        auto subscription = std::make_shared<WriteSubscription>(static_cast<std::uint8_t>(unit_id.value), type, start, count, capacity);
+        subscriptions_.push_back(subscription);
+        return subscription;
+    }
+
+    /**
+     * @brief Hits and misses of the response cache, zero when it is not enabled
+     */
+    modbus::ResponseCacheStats response_cache_stats() const {
+        return cache_ ? cache_->stats() : modbus::ResponseCacheStats{};
+    }
+
+    /**
+     * @brief Whether requests for the unit ID are served
+     */
+    bool serves(modbus::UnitID unit_id) const {
+        return unit_id.value < MAX_UNIT_IDS && units_[unit_id.value] != nullptr;
+    }
 
     void start(const modbus::Ipv4& ipv4, const modbus::Port& port) {
+        started_ = true;
         transport_->start_accepting(ipv4.value, port.value, [this](std::unique_ptr<IModbusChannel> channel) {
             this->handle_new_connection(std::move(channel));
         });
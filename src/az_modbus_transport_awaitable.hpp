@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <vector>
 #include <string>
+#include <span>
 #include <future>
 #include <asio.hpp>
 
@@ -21,10 +22,33 @@ public:
 
     virtual std::future<std::vector<std::uint8_t>> read(size_t bytes_to_read) = 0;
 
+    // Reads whatever is available (at least one byte) into the caller buffer.
+    virtual std::future<size_t> read_some(std::span<std::uint8_t> buffer) = 0;
+
+    virtual awaitable<void> co_connect(const std::string& host, const std::string& port) = 0;
+
     virtual awaitable<std::vector<std::uint8_t>> co_read(size_t bytes_to_read) = 0;
 
+    virtual awaitable<size_t> co_read_some(std::span<std::uint8_t> buffer) = 0;
+
     virtual awaitable<size_t> co_write(const std::vector<std::uint8_t>& data) = 0;
 
+    // Writes a buffer sequence (one or more frames), channels may send it without joining the buffers.
+    virtual awaitable<size_t> co_write(std::span<const asio::const_buffer> buffers) {
+        std::vector<std::uint8_t> data(asio::buffer_size(buffers));
+        asio::buffer_copy(asio::buffer(data), buffers);
+        co_return co_await co_write(data);
+    }
+
+    // Writes several frames in order, channels may send them with a single gather write.
+    virtual awaitable<size_t> co_write_batch(std::span<const std::vector<std::uint8_t>> frames) {
+        size_t written = 0;
+        for (const auto& frame : frames) {
+            written += co_await co_write(frame);
+        }
+        co_return written;
+    }
+
     virtual asio::any_io_executor get_executor() = 0;
 
     virtual void close() = 0;
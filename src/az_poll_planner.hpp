@@ -0,0 +1,170 @@
+#pragma once
+
+#include "az_modbus_protocol.hpp"
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+namespace modbus {
+
+/**
+ * @brief One polled tag: a block of addresses of one table
+ */
+struct PollTag {
+    FunctionCode function_code; // ReadCoils, ReadDiscreteInputs, HoldingRegisters or InputRegisters
+    std::uint16_t address;
+    std::uint16_t count;
+};
+
+/**
+ * @brief Values of one tag: coils (one byte per coil) or registers
+ */
+using PollValue = std::variant<std::vector<std::uint8_t>, std::vector<std::uint16_t>>;
+
+/**
+ * @brief One read request of a plan and the tags it serves
+ */
+struct PollRequest {
+    FunctionCode function_code;
+    std::uint16_t address;
+    std::uint16_t quantity;
+    std::vector<size_t> tags; // Indices in the planned tag list
+};
+
+/**
+ * @brief Result of PollPlanner::plan()
+ */
+struct PollPlan {
+    std::vector<PollTag> tags;
+    std::vector<PollRequest> requests;
+
+    // Requests needed when every tag is read on its own.
+    size_t naive_request_count() const { return tags.size(); }
+    size_t request_count() const { return requests.size(); }
+    size_t requests_saved() const { return naive_request_count() - request_count(); }
+
+    /**
+     * @brief Fraction of the per-tag requests removed by the plan (0 when nothing was merged)
+     */
+    double reduction() const {
+        return tags.empty() ? 0.0 : static_cast<double>(requests_saved()) / naive_request_count();
+    }
+};
+
+/**
+ * @brief Merges scattered tags into the fewest FC 0x01 - 0x04 read requests
+ *
+ * Tags of the same table are sorted by address and swept once: a tag joins the
+ * current request while the hole before it is at most the gap tolerance and the
+ * request stays within the protocol limit (2000 coils / 125 registers). Holes
+ * are read and discarded, so a larger tolerance trades bytes for round trips.
+ * The plan only depends on the tag list, ties are broken by tag index.
+ */
+class PollPlanner {
+private:
+    std::uint16_t max_bit_gap_;
+    std::uint16_t max_register_gap_;
+
+    static bool is_bit_table(FunctionCode function_code) {
+        return function_code == ReadCoils || function_code == ReadDiscreteInputs;
+    }
+
+    static void check_tag(const PollTag& tag) {
+        switch (tag.function_code) {
+            case ReadCoils:
+            case ReadDiscreteInputs:
+            case HoldingRegisters:
+            case InputRegisters:
+                break;
+            default:
+                throw std::runtime_error("Function Code " + std::to_string(tag.function_code) + " can not be polled");
+        }
+        if (tag.count == 0 || tag.count > max_read_quantity(tag.function_code))
+            throw std::runtime_error("invalid tag quantity");
+        if (tag.address + size_t{tag.count} > 0x10000)
+            throw std::runtime_error("tag exceeds the address space");
+    }
+
+public:
+    /**
+     * @param max_register_gap unused registers a request may read to merge two tags
+     * @param max_bit_gap unused coils/inputs a request may read to merge two tags
+     */
+    explicit PollPlanner(std::uint16_t max_register_gap = 0, std::uint16_t max_bit_gap = 0)
+        : max_bit_gap_(max_bit_gap), max_register_gap_(max_register_gap) {}
+
+    /**
+     * @brief Build the request list for a set of tags
+     *
+     * @param tags tags to poll, may overlap
+     * @return plan, requests ordered by function code then address
+     */
+    PollPlan plan(std::span<const PollTag> tags) const {
+        PollPlan plan;
+        plan.tags.assign(tags.begin(), tags.end());
+        for (const auto& tag : plan.tags) {
+            check_tag(tag);
+        }
+
+        std::vector<size_t> order(plan.tags.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            const auto& ta = plan.tags[a];
+            const auto& tb = plan.tags[b];
+            if (ta.function_code != tb.function_code) return ta.function_code < tb.function_code;
+            if (ta.address != tb.address) return ta.address < tb.address;
+            return a < b;
+        });
+
+        size_t end = 0; // One past the last address of the current request
+        for (size_t index : order) {
+            const auto& tag = plan.tags[index];
+            size_t gap = is_bit_table(tag.function_code) ? max_bit_gap_ : max_register_gap_;
+            size_t tag_end = tag.address + size_t{tag.count};
+
+            if (!plan.requests.empty()) {
+                auto& current = plan.requests.back();
+                size_t merged_end = std::max(end, tag_end);
+                if (current.function_code == tag.function_code &&
+                    tag.address <= end + gap &&
+                    merged_end - current.address <= max_read_quantity(tag.function_code)) {
+                    end = merged_end;
+                    current.quantity = static_cast<std::uint16_t>(end - current.address);
+                    current.tags.push_back(index);
+                    continue;
+                }
+            }
+            plan.requests.push_back(PollRequest{tag.function_code, tag.address, tag.count, {index}});
+            end = tag_end;
+        }
+        return plan;
+    }
+
+    /**
+     * @brief Copy the values of one request response into its tags
+     *
+     * @param plan plan the request belongs to
+     * @param request_index index of the request in plan.requests
+     * @param response values read for the whole request
+     * @param values per tag values, resized to plan.tags.size() when empty
+     */
+    static void scatter(const PollPlan& plan, size_t request_index, const PollValue& response, std::vector<PollValue>& values) {
+        values.resize(plan.tags.size());
+        const auto& request = plan.requests.at(request_index);
+
+        std::visit([&](const auto& data) {
+            using Vector = std::decay_t<decltype(data)>;
+            if (data.size() < request.quantity)
+                throw std::runtime_error("poll response too short");
+
+            for (size_t index : request.tags) {
+                const auto& tag = plan.tags[index];
+                auto first = data.begin() + (tag.address - request.address);
+                values[index] = Vector(first, first + tag.count);
+            }
+        }, response);
+    }
+};
+
+} // namespace modbus
@@ -0,0 +1,424 @@
+#pragma once
+
+#include "az_database_interface.hpp"
+#include "az_bit_table.hpp"
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace db {
+
+/**
+ * @brief Number of addresses per table (full Modbus address space)
+ */
+constexpr size_t REGISTER_BANK_SIZE = 0x10000;
+
+/**
+ * @brief Cache line size used to keep the tables and their sequence counters apart
+ */
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+/**
+ * @brief One table of the register bank
+ *
+ * Plain data so the same layout can live in ordinary memory or in a mapping.
+ * The low half of sequence is a counter, odd while a range write is in
+ * progress, and the high half then holds the ID of the writer (see
+ * SeqlockTable). The generation counts every write once it is visible.
+ */
+template <typename T, size_t N = REGISTER_BANK_SIZE>
+struct alignas(CACHE_LINE_SIZE) BankTable {
+    std::uint64_t sequence;
+    std::uint64_t generation;
+    alignas(CACHE_LINE_SIZE) T values[N];
+};
+
+/**
+ * @brief Bit table of the register bank, 64 addresses per word (8 KiB)
+ */
+using BitBankTable = BankTable<std::uint64_t, bits::word_count(REGISTER_BANK_SIZE)>;
+
+/**
+ * @brief Memory layout of the four Modbus tables
+ */
+struct RegisterBankLayout {
+    BitBankTable coils;
+    BitBankTable discrete_inputs;
+    BankTable<std::uint16_t> holding_registers;
+    BankTable<std::uint16_t> input_registers;
+};
+
+/**
+ * @brief Whether the writer with this ID has died, see SeqlockTable
+ */
+using WriterGone = bool (*)(std::uint32_t writer);
+
+/**
+ * @brief Seqlock access to a BankTable
+ *
+ * Single word reads and writes are plain atomic loads/stores. Range writers
+ * serialise among themselves on the sequence counter, range readers never
+ * block: they copy the range and retry if a range write overlapped the copy.
+ *
+ * A range writer stores its ID next to the odd counter. When the table is
+ * shared between processes (writer IDs are then process IDs), a writer that
+ * died in the middle of a range write would leave the counter odd and every
+ * other reader and writer waiting forever: waiters that keep seeing the same
+ * odd counter ask writer_gone about its writer and, if it is gone, release
+ * the write in its place. The values it was writing may be partly updated.
+ *
+ * The release skips the even value the writer ends its write with, so a writer
+ * wrongly reported gone finds its write released when it ends it: it then
+ * moves the counter again, and readers whose copy overlapped the end of its
+ * write retry. Readers that copied and validated entirely between the release
+ * and that end may still have returned a partly updated range.
+ */
+template <typename T, size_t N = REGISTER_BANK_SIZE>
+class SeqlockTable {
+private:
+    // Wide snapshot loads alias the table values, hence may_alias.
+    using Word = std::uint64_t __attribute__((may_alias));
+    static constexpr size_t PER_WORD = sizeof(Word) / sizeof(T);
+    static constexpr std::uint64_t COUNTER_MASK = 0xFFFFFFFF;
+    // Yields between two checks of the writer holding the counter odd.
+    static constexpr size_t WRITER_CHECK_WAITS = 1024;
+    // A released write moves the odd counter past the even value its writer ends with.
+    static constexpr std::uint64_t RELEASE_STEP = 3;
+
+    BankTable<T, N>* table_;
+    std::uint32_t writer_;
+    WriterGone writer_gone_;
+
+    std::atomic_ref<std::uint64_t> sequence() const {
+        return std::atomic_ref<std::uint64_t>(table_->sequence);
+    }
+
+    /**
+     * @brief Wait step while a range write is in progress
+     *
+     * @param current odd sequence value seen
+     * @param waits wait steps made so far on this value
+     */
+    void wait_writer(std::uint64_t current, size_t& waits) const {
+        std::this_thread::yield();
+        if (!writer_gone_ || ++waits % WRITER_CHECK_WAITS != 0) return;
+
+        auto writer = static_cast<std::uint32_t>(current >> 32);
+        if (!writer_gone_(writer)) return;
+        // Only one waiter releases the write, the generation makes cached responses of it miss.
+        if (sequence().compare_exchange_strong(current, ((current & COUNTER_MASK) + RELEASE_STEP) & COUNTER_MASK,
+                std::memory_order_acq_rel)) {
+            bump_generation();
+        }
+    }
+
+    /**
+     * @brief End a range write started from the odd value locked
+     *
+     * When a waiter released the write meanwhile, the counter moves once more
+     * (unless another write is already in progress and will move it), so a
+     * read of the released value never validates against the values written.
+     */
+    void end_write(std::uint64_t locked) {
+        std::uint64_t current = locked;
+        if (sequence().compare_exchange_strong(current, ((locked & COUNTER_MASK) + 1) & COUNTER_MASK,
+                std::memory_order_release)) {
+            return;
+        }
+        while (!(current & 1) && !sequence().compare_exchange_weak(current, (current + 2) & COUNTER_MASK,
+                std::memory_order_release)) {}
+    }
+
+    // Bumped after the written values, a reader seeing the new generation sees them too.
+    void bump_generation() const {
+        std::atomic_ref<std::uint64_t>(table_->generation).fetch_add(1, std::memory_order_release);
+    }
+
+public:
+    /**
+     * @param table table accessed
+     * @param writer ID stored while this accessor runs a range write
+     * @param writer_gone tells whether a writer has died, nullptr when writers cannot die on their own (one process)
+     */
+    explicit SeqlockTable(BankTable<T, N>* table, std::uint32_t writer = 0, WriterGone writer_gone = nullptr)
+        : table_(table), writer_(writer), writer_gone_(writer_gone) {}
+
+    T load(size_t id) const {
+        return std::atomic_ref<T>(table_->values[id]).load(std::memory_order_acquire);
+    }
+
+    void store(size_t id, T value) {
+        std::atomic_ref<T>(table_->values[id]).store(value, std::memory_order_release);
+        bump_generation();
+    }
+
+    /**
+     * @brief Number of writes made to the table
+     */
+    std::uint64_t generation() const {
+        return std::atomic_ref<std::uint64_t>(table_->generation).load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Consistent snapshot of [start, start + count)
+     *
+     * @param start first address
+     * @param count number of values
+     * @param visit called as visit(index, value) for every value of the snapshot,
+     *        may be called again from index 0 when the copy is retried
+     */
+    template <typename Visitor>
+    void read_range(size_t start, size_t count, Visitor&& visit) const {
+        size_t waits = 0;
+        while (true) {
+            std::uint64_t before = sequence().load(std::memory_order_acquire);
+            if (before & 1) {
+                wait_writer(before, waits);
+                continue;
+            }
+            for (size_t i = 0; i < count; ++i) {
+                visit(i, std::atomic_ref<T>(table_->values[start + i]).load(std::memory_order_relaxed));
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence().load(std::memory_order_relaxed) == before) {
+                return;
+            }
+        }
+    }
+
+    /**
+     * @brief Consistent snapshot of [start, start + out.size()) copied into out
+     *
+     * Same guarantee as read_range(), the aligned middle of the range is copied
+     * one 64-bit word at a time.
+     */
+    void copy_to(size_t start, std::span<T> out) const {
+        size_t waits = 0;
+        while (true) {
+            std::uint64_t before = sequence().load(std::memory_order_acquire);
+            if (before & 1) {
+                wait_writer(before, waits);
+                continue;
+            }
+            size_t i = 0;
+            for (; i < out.size() && (start + i) % PER_WORD != 0; ++i) {
+                out[i] = std::atomic_ref<T>(table_->values[start + i]).load(std::memory_order_relaxed);
+            }
+            for (; i + PER_WORD <= out.size(); i += PER_WORD) {
+                Word word = __atomic_load_n(reinterpret_cast<const Word*>(&table_->values[start + i]), __ATOMIC_RELAXED);
+                std::memcpy(&out[i], &word, sizeof(word));
+            }
+            for (; i < out.size(); ++i) {
+                out[i] = std::atomic_ref<T>(table_->values[start + i]).load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence().load(std::memory_order_relaxed) == before) {
+                return;
+            }
+        }
+    }
+
+    /**
+     * @brief Atomic update of [start, start + count) as seen by read_range
+     *
+     * @param start first address
+     * @param count number of values
+     * @param value called as value(index) for every address to be written
+     */
+    template <typename Producer>
+    void write_range(size_t start, size_t count, Producer&& value) {
+        update_range(start, count, [&](size_t i, T) { return value(i); });
+    }
+
+    /**
+     * @brief Read-modify-write of [start, start + count), atomic as seen by read_range
+     *
+     * @param start first address
+     * @param count number of values
+     * @param update called as update(index, current) for every address, returns the new value
+     */
+    template <typename Update>
+    void update_range(size_t start, size_t count, Update&& update) {
+        std::uint64_t current = sequence().load(std::memory_order_relaxed);
+        std::uint64_t locked = 0;
+        size_t waits = 0;
+        do {
+            while (current & 1) {
+                wait_writer(current, waits);
+                current = sequence().load(std::memory_order_relaxed);
+            }
+            locked = (std::uint64_t{writer_} << 32) | ((current + 1) & COUNTER_MASK);
+        } while (!sequence().compare_exchange_weak(current, locked, std::memory_order_acquire));
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (size_t i = 0; i < count; ++i) {
+            std::atomic_ref<T> slot(table_->values[start + i]);
+            slot.store(update(i, slot.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+        }
+        bump_generation();
+        end_write(locked);
+    }
+};
+
+/**
+ * @brief Library provided DatabaseInterface holding the four Modbus tables
+ *
+ * Every table covers the full 65536 address space in cache line aligned
+ * arrays, coils and discrete inputs packed 64 per word. Readers never take a
+ * lock: single reads are atomic loads and range reads use a seqlock snapshot.
+ * Single register writes are atomic stores and do not serialise readers, range
+ * writes and every bit write (a masked word update) only serialise against
+ * other writers of the same table.
+ */
+class RegisterBank : public DatabaseInterface {
+private:
+    std::unique_ptr<RegisterBankLayout> owned_;
+    RegisterBankLayout* layout_;
+    std::uint32_t writer_ = 0;
+    WriterGone writer_gone_ = nullptr;
+
+    static std::uint16_t to_word(std::variant<std::uint8_t, std::uint16_t> value) {
+        return std::visit([](auto v) { return static_cast<std::uint16_t>(v); }, value);
+    }
+
+    // Words covering a 2000 bit read (the Modbus limit) at any alignment.
+    static constexpr size_t SNAPSHOT_WORDS = bits::word_count(2000) + 1;
+
+    static bool in_bank(size_t start, size_t count) {
+        return start + count <= REGISTER_BANK_SIZE;
+    }
+
+protected:
+    // Serves a layout owned by someone else (e.g. a file or shared memory mapping).
+    explicit RegisterBank(RegisterBankLayout* layout) : layout_(layout) {}
+
+    void attach(RegisterBankLayout* layout) {
+        layout_ = layout;
+    }
+
+    RegisterBankLayout* layout() const {
+        return layout_;
+    }
+
+    // Range writes of other processes sharing the layout may be released if they die, see SeqlockTable.
+    void set_writer(std::uint32_t writer, WriterGone writer_gone) {
+        writer_ = writer;
+        writer_gone_ = writer_gone;
+    }
+
+    using BitSeqlockTable = SeqlockTable<std::uint64_t, bits::word_count(REGISTER_BANK_SIZE)>;
+
+    BitSeqlockTable bit_words(db::DbType type) const {
+        return BitSeqlockTable(type == db::DbType::BITS ? &layout_->coils : &layout_->discrete_inputs, writer_, writer_gone_);
+    }
+
+    // Every bit write is a seqlock word update, so concurrent writes to neighbouring bits are never lost.
+    void write_bits(db::DbType type, std::uint16_t start, std::uint16_t count, std::span<const std::uint8_t> packed) {
+        size_t first = start / bits::WORD_BITS;
+        size_t last = (start + size_t{count} - 1) / bits::WORD_BITS;
+        bit_words(type).update_range(first, last - first + 1, [&](size_t i, std::uint64_t current) {
+            return bits::merge_word(current, first + i, start, count, packed);
+        });
+    }
+
+    SeqlockTable<std::uint16_t> registers(db::DbType type) const {
+        return SeqlockTable<std::uint16_t>(type == db::DbType::REGISTER ? &layout_->holding_registers : &layout_->input_registers,
+            writer_, writer_gone_);
+    }
+
+    static bool is_bit_table(db::DbType type) {
+        return type == db::DbType::BITS || type == db::DbType::BITS_INPUT;
+    }
+
+public:
+    RegisterBank()
+        : owned_(std::make_unique<RegisterBankLayout>()), layout_(owned_.get()) {}
+
+    bool connect() override { return layout_ != nullptr; }
+    bool release() override { return true; }
+
+    // Every table always spans the whole address space, db_create only clears them.
+    bool db_create(std::uint16_t) override {
+        for (auto type : {db::DbType::BITS, db::DbType::BITS_INPUT}) {
+            bit_words(type).write_range(0, bits::word_count(REGISTER_BANK_SIZE), [](size_t) { return std::uint64_t{0}; });
+        }
+        for (auto type : {db::DbType::REGISTER, db::DbType::REGISTER_INPUT}) {
+            registers(type).write_range(0, REGISTER_BANK_SIZE, [](size_t) { return std::uint16_t{0}; });
+        }
+        return true;
+    }
+
+    std::variant<std::uint8_t, std::uint16_t> db_read(db::DbType type, std::uint16_t id) override {
+        if (is_bit_table(type)) {
+            return static_cast<std::uint8_t>((bit_words(type).load(id / bits::WORD_BITS) >> (id % bits::WORD_BITS)) & 1);
+        }
+        return registers(type).load(id);
+    }
+
+    bool db_update(db::DbType type, std::uint16_t id, std::variant<std::uint8_t, std::uint16_t> value) override {
+        if (is_bit_table(type)) {
+            std::uint8_t bit = to_word(value) ? 1 : 0;
+            write_bits(type, id, 1, std::span<const std::uint8_t>(&bit, 1));
+        }
+        else registers(type).store(id, to_word(value));
+        return true;
+    }
+
+    bool db_delete(db::DbType type, std::uint16_t id) override {
+        return db_update(type, id, std::uint16_t{0});
+    }
+
+    bool db_read_range(db::DbType type, std::uint16_t start, std::span<std::uint16_t> values) override {
+        if (is_bit_table(type) || !in_bank(start, values.size())) return false;
+        registers(type).copy_to(start, values);
+        return true;
+    }
+
+    bool db_write_range(db::DbType type, std::uint16_t start, std::span<const std::uint16_t> values) override {
+        if (is_bit_table(type) || !in_bank(start, values.size())) return false;
+        if (values.size() == 1) {
+            registers(type).store(start, values[0]);
+            return true;
+        }
+        registers(type).write_range(start, values.size(), [&](size_t i) { return values[i]; });
+        return true;
+    }
+
+    bool db_read_bits(db::DbType type, std::uint16_t start, std::uint16_t count, std::span<std::uint8_t> packed) override {
+        if (!is_bit_table(type) || !in_bank(start, count)) return false;
+        if (count == 0) return true;
+
+        // Snapshot the covering words, then shift them into the packed format. The snapshot of a
+        // read up to the protocol limit stays on the stack, larger ones go to the heap.
+        size_t first = start / bits::WORD_BITS;
+        size_t last = (start + size_t{count} - 1) / bits::WORD_BITS;
+        std::array<std::uint64_t, SNAPSHOT_WORDS> stack_words;
+        std::vector<std::uint64_t> heap_words;
+        std::span<std::uint64_t> words(stack_words);
+        if (last - first + 1 > words.size()) {
+            heap_words.resize(last - first + 1);
+            words = heap_words;
+        }
+        words = words.first(last - first + 1);
+        bit_words(type).copy_to(first, words);
+        bits::read_packed(words, start % bits::WORD_BITS, count, packed);
+        return true;
+    }
+
+    bool db_write_bits(db::DbType type, std::uint16_t start, std::uint16_t count, std::span<const std::uint8_t> packed) override {
+        if (!is_bit_table(type) || !in_bank(start, count)) return false;
+        if (count == 0) return true;
+        write_bits(type, start, count, packed);
+        return true;
+    }
+
+    std::optional<std::uint64_t> db_generation(db::DbType type) override {
+        if (is_bit_table(type)) return bit_words(type).generation();
+        return registers(type).generation();
+    }
+};
+
+} // namespace db
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "az_modbus_protocol.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+namespace modbus {
+
+/**
+ * @brief Read request identifying a cached response
+ */
+struct ResponseCacheKey {
+    std::uint8_t unit_id = 0;
+    std::uint8_t function_code = 0;
+    std::uint16_t start_addr = 0;
+    std::uint16_t quantity = 0;
+
+    bool operator==(const ResponseCacheKey&) const = default;
+};
+
+/**
+ * @brief Hit and miss counters of a ResponseCache
+ */
+struct ResponseCacheStats {
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+};
+
+/**
+ * @brief Encoded read responses shared by every connection of a server
+ *
+ * Direct mapped: a key owns one slot and a colliding key evicts it. Every
+ * entry records the write generation of its table when the data was read, a
+ * lookup only hits when the table generation is still the same. Since the key
+ * fixes the unit ID and the length, a hit copies the whole ADU and patches the
+ * transaction ID. Each slot has its own mutex, held for the copy only.
+ */
+class ResponseCache {
+public:
+    static constexpr size_t DEFAULT_SLOTS = 256;
+
+private:
+    // Longest read response payload, 125 registers.
+    static constexpr size_t MAX_PAYLOAD_SIZE = 2 * MAX_READ_REGISTERS;
+
+    struct Slot {
+        std::mutex mtx;
+        bool valid = false;
+        ResponseCacheKey key;
+        std::uint64_t generation = 0;
+        std::array<std::uint8_t, MBAP_HEADER_SIZE + 5> header{};
+        size_t header_size = 0;
+        std::array<std::uint8_t, MAX_PAYLOAD_SIZE> payload{};
+        size_t payload_size = 0;
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+    size_t mask_;
+    alignas(64) std::atomic<std::uint64_t> hits_{0};
+    alignas(64) std::atomic<std::uint64_t> misses_{0};
+
+    Slot& slot(const ResponseCacheKey& key) {
+        std::uint64_t hash = (std::uint64_t{key.unit_id} << 40) | (std::uint64_t{key.function_code} << 32)
+            | (std::uint64_t{key.start_addr} << 16) | key.quantity;
+        hash *= 0x9E3779B97F4A7C15ull;
+        return slots_[(hash >> 32) & mask_];
+    }
+
+public:
+    /**
+     * @param slots number of entries, rounded up to a power of two
+     */
+    explicit ResponseCache(size_t slots = DEFAULT_SLOTS)
+        : slots_(std::make_unique<Slot[]>(std::bit_ceil(std::max<size_t>(slots, 1)))),
+          mask_(std::bit_ceil(std::max<size_t>(slots, 1)) - 1) {}
+
+    /**
+     * @brief Copy the cached response of key into frame
+     *
+     * @param key request
+     * @param generation current write generation of the table read by the request
+     * @param transaction_id transaction ID of the request, written into the copied header
+     * @param frame output frame, its payload refers to payload_storage
+     * @param payload_storage receives the payload, at least 250 bytes
+     * @return false on a miss, frame is then left untouched
+     */
+    bool lookup(const ResponseCacheKey& key, std::uint64_t generation, std::uint16_t transaction_id,
+        ResponseFrame& frame, std::span<std::uint8_t> payload_storage) {
+        auto& entry = slot(key);
+        {
+            std::lock_guard<std::mutex> lock(entry.mtx);
+            if (entry.valid && entry.key == key && entry.generation == generation) {
+                frame.header = entry.header;
+                frame.header_size = entry.header_size;
+                std::memcpy(payload_storage.data(), entry.payload.data(), entry.payload_size);
+                frame.payload = payload_storage.first(entry.payload_size);
+                frame.header[0] = static_cast<std::uint8_t>(transaction_id >> 8);
+                frame.header[1] = static_cast<std::uint8_t>(transaction_id & 0xFF);
+                hits_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    /**
+     * @brief Store the response of key
+     *
+     * @param key request
+     * @param generation write generation of the table read before the data was read
+     * @param frame encoded read response
+     */
+    void insert(const ResponseCacheKey& key, std::uint64_t generation, const ResponseFrame& frame) {
+        if (frame.payload.size() > MAX_PAYLOAD_SIZE) return;
+
+        auto& entry = slot(key);
+        std::lock_guard<std::mutex> lock(entry.mtx);
+        entry.valid = true;
+        entry.key = key;
+        entry.generation = generation;
+        entry.header = frame.header;
+        entry.header_size = frame.header_size;
+        std::memcpy(entry.payload.data(), frame.payload.data(), frame.payload.size());
+        entry.payload_size = frame.payload.size();
+    }
+
+    ResponseCacheStats stats() const {
+        return {hits_.load(std::memory_order_relaxed), misses_.load(std::memory_order_relaxed)};
+    }
+};
+
+} // namespace modbus
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "az_mapped_register_bank.hpp"
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace db {
+
+/**
+ * @brief RegisterBank in a POSIX shared memory object, shared between processes
+ *
+ * Every process opening the same name maps the same pages: a field data
+ * producer writes the input tables with db_write_range() / db_write_bits()
+ * and the Modbus server reads them in place, without any IPC or copy per
+ * update. The seqlock and the write generations live in the shared pages, so
+ * range reads stay consistent and cached responses are invalidated across
+ * processes as well.
+ *
+ * The object uses the MappedRegisterBank file format. The first process
+ * creates and initialises it, the others attach to it; it outlives them all
+ * until remove() is called. A process attaching while the creator is still
+ * initialising the object gets an exception and may retry.
+ *
+ * Range writes are tagged with the writer's process ID. With
+ * release_dead_writers, a process killed in the middle of a range write does
+ * not block the others: a reader or writer that keeps finding the write
+ * unfinished checks whether that process still exists and, if not, releases
+ * the write (SeqlockTable). The range it was writing may then hold part of the
+ * update until it is written again. The check only works when every process
+ * sharing the object runs in the same PID namespace: a writer in another
+ * namespace would be found gone while it is still writing, and readers could
+ * return a partly written range. A process ID reused by a new process before
+ * the check keeps the write held. The release is therefore off by default.
+ */
+class SharedRegisterBank : public RegisterBank {
+private:
+    static constexpr size_t LAYOUT_OFFSET = MappedBankHeader::LAYOUT_OFFSET;
+    static constexpr size_t SHARED_SIZE = LAYOUT_OFFSET + sizeof(RegisterBankLayout);
+
+    std::uint8_t* mapping_ = nullptr;
+    bool created_ = false;
+
+    static bool process_gone(std::uint32_t pid) {
+        return kill(static_cast<pid_t>(pid), 0) != 0 && errno == ESRCH;
+    }
+
+    [[noreturn]] static void fail(const std::string& what, int fd) {
+        std::string message = what + ": " + std::strerror(errno);
+        if (fd >= 0) close(fd);
+        throw std::runtime_error(message);
+    }
+
+    void open_shared(const std::string& name, bool release_dead_writers) {
+        int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0660);
+        created_ = fd >= 0;
+        if (!created_ && errno == EEXIST) fd = shm_open(name.c_str(), O_RDWR, 0);
+        if (fd < 0) fail("cannot open shared memory " + name, fd);
+
+        if (created_ && ftruncate(fd, SHARED_SIZE) != 0) fail("cannot size shared memory " + name, fd);
+        struct stat st;
+        if (fstat(fd, &st) != 0) fail("cannot stat shared memory " + name, fd);
+        if (static_cast<size_t>(st.st_size) != SHARED_SIZE) {
+            errno = EINVAL;
+            fail("shared register bank size mismatch " + name, fd);
+        }
+
+        void* mapping = mmap(nullptr, SHARED_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) fail("cannot map shared memory " + name, fd);
+        close(fd);
+        mapping_ = static_cast<std::uint8_t*>(mapping);
+
+        auto* header = reinterpret_cast<MappedBankHeader*>(mapping_);
+        if (created_) {
+            // The tables are zero filled, the magic is written last and marks the object as ready.
+            header->version = MappedBankHeader::VERSION;
+            header->header_size = LAYOUT_OFFSET;
+            header->layout_size = sizeof(RegisterBankLayout);
+            std::atomic_thread_fence(std::memory_order_release);
+            std::memcpy(header->magic, MappedBankHeader::MAGIC, sizeof(header->magic));
+        }
+        else {
+            bool ready = std::memcmp(header->magic, MappedBankHeader::MAGIC, sizeof(header->magic)) == 0;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (!ready || header->version != MappedBankHeader::VERSION
+                || header->header_size != LAYOUT_OFFSET
+                || header->layout_size != sizeof(RegisterBankLayout)) {
+                munmap(mapping_, SHARED_SIZE);
+                mapping_ = nullptr;
+                throw std::runtime_error("incompatible or uninitialised shared register bank " + name);
+            }
+        }
+        attach(reinterpret_cast<RegisterBankLayout*>(mapping_ + LAYOUT_OFFSET));
+        set_writer(static_cast<std::uint32_t>(getpid()), release_dead_writers ? &process_gone : nullptr);
+    }
+
+public:
+    /**
+     * @param name shared memory object name, e.g. "/az_modbus_bank"
+     * @param release_dead_writers release range writes of dead processes, only when
+     *        every process sharing the object runs in the same PID namespace
+     */
+    explicit SharedRegisterBank(const std::string& name, bool release_dead_writers = false)
+        : RegisterBank(nullptr) {
+        open_shared(name, release_dead_writers);
+    }
+
+    SharedRegisterBank(const SharedRegisterBank&) = delete;
+    SharedRegisterBank& operator=(const SharedRegisterBank&) = delete;
+
+    ~SharedRegisterBank() override {
+        if (mapping_) munmap(mapping_, SHARED_SIZE);
+    }
+
+    /**
+     * @brief Whether this process created the shared memory object
+     */
+    bool created() const {
+        return created_;
+    }
+
+    /**
+     * @brief Remove the shared memory object, mappings already open stay valid
+     *
+     * @return false when no object of that name exists
+     */
+    static bool remove(const std::string& name) {
+        return shm_unlink(name.c_str()) == 0;
+    }
+};
+
+} // namespace db
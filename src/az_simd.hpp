@@ -0,0 +1,223 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+#if defined(__AVX2__) || defined(__SSSE3__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace modbus::simd {
+
+/**
+ * @brief Portable kernels, also used for the tails of the vector kernels
+ */
+namespace scalar {
+
+/**
+ * @brief Pack one byte per bit (non zero = 1) into Modbus LSB-first bytes
+ *
+ * @param bits input, one byte per bit
+ * @param packed output, at least (bits.size() + 7) / 8 bytes
+ */
+inline void pack_bits(std::span<const std::uint8_t> bits, std::span<std::uint8_t> packed) {
+    size_t i = 0;
+    if constexpr (std::endian::native == std::endian::little) {
+        // Eight bytes at a time: normalise every byte to 0/1, then gather the
+        // low bit of each byte into the top byte with one multiplication.
+        for (; i + 8 <= bits.size(); i += 8) {
+            std::uint64_t word;
+            std::memcpy(&word, bits.data() + i, sizeof(word));
+            word = (((word & 0x7F7F7F7F7F7F7F7FULL) + 0x7F7F7F7F7F7F7F7FULL) | word) & 0x8080808080808080ULL;
+            packed[i / 8] = static_cast<std::uint8_t>(((word >> 7) * 0x0102040810204080ULL) >> 56);
+        }
+    }
+    if (i < bits.size()) {
+        std::uint8_t last = 0;
+        for (size_t bit = 0; i + bit < bits.size(); ++bit) {
+            last |= static_cast<std::uint8_t>((bits[i + bit] != 0) << bit);
+        }
+        packed[i / 8] = last;
+    }
+}
+
+/**
+ * @brief Expand Modbus LSB-first bytes into one byte (0 or 1) per bit
+ *
+ * @param packed input, at least (bits.size() + 7) / 8 bytes
+ * @param bits output, one byte per bit
+ */
+inline void unpack_bits(std::span<const std::uint8_t> packed, std::span<std::uint8_t> bits) {
+    size_t i = 0;
+    if constexpr (std::endian::native == std::endian::little) {
+        // Broadcast the byte, keep bit n in byte n, then turn non zero bytes into 1.
+        for (; i + 8 <= bits.size(); i += 8) {
+            std::uint64_t word = (packed[i / 8] * 0x0101010101010101ULL) & 0x8040201008040201ULL;
+            word = ((word + 0x7F7F7F7F7F7F7F7FULL) >> 7) & 0x0101010101010101ULL;
+            std::memcpy(bits.data() + i, &word, sizeof(word));
+        }
+    }
+    for (; i < bits.size(); ++i) {
+        bits[i] = (packed[i / 8] >> (i % 8)) & 0x01;
+    }
+}
+
+/**
+ * @brief Swap the bytes of count 16-bit words (in and out may be the same buffer)
+ */
+inline void swap_bytes_16(const std::uint8_t* in, std::uint8_t* out, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        std::uint16_t word;
+        std::memcpy(&word, in + i * 2, sizeof(word));
+        word = std::byteswap(word);
+        std::memcpy(out + i * 2, &word, sizeof(word));
+    }
+}
+
+} // namespace scalar
+
+/**
+ * @brief Pack one byte per bit (non zero = 1) into Modbus LSB-first bytes
+ *
+ * Uses AVX2 (32 bits per step) or SSE2 (16 bits per step) when the target
+ * enables them, the scalar kernel otherwise.
+ *
+ * @param bits input, one byte per bit
+ * @param packed output, at least (bits.size() + 7) / 8 bytes
+ */
+inline void pack_bits(std::span<const std::uint8_t> bits, std::span<std::uint8_t> packed) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i zero256 = _mm256_setzero_si256();
+    for (; i + 32 <= bits.size(); i += 32) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bits.data() + i));
+        std::uint32_t mask = ~static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, zero256)));
+        std::memcpy(packed.data() + i / 8, &mask, sizeof(mask));
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i zero128 = _mm_setzero_si128();
+    for (; i + 16 <= bits.size(); i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bits.data() + i));
+        std::uint16_t mask = static_cast<std::uint16_t>(~_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, zero128)));
+        std::memcpy(packed.data() + i / 8, &mask, sizeof(mask));
+    }
+#endif
+    scalar::pack_bits(bits.subspan(i), packed.subspan(i / 8));
+}
+
+/**
+ * @brief Expand Modbus LSB-first bytes into one byte (0 or 1) per bit
+ *
+ * Uses AVX2 (32 bits per step) or SSE2 (16 bits per step) when the target
+ * enables them, the scalar kernel otherwise.
+ *
+ * @param packed input, at least (bits.size() + 7) / 8 bytes
+ * @param bits output, one byte per bit
+ */
+inline void unpack_bits(std::span<const std::uint8_t> packed, std::span<std::uint8_t> bits) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i select256 = _mm256_set1_epi64x(static_cast<long long>(0x8040201008040201ULL));
+    const __m256i one256 = _mm256_set1_epi8(1);
+    for (; i + 32 <= bits.size(); i += 32) {
+        const std::uint8_t* in = packed.data() + i / 8;
+        __m256i spread = _mm256_set_epi64x(
+            static_cast<long long>(in[3] * 0x0101010101010101ULL), static_cast<long long>(in[2] * 0x0101010101010101ULL),
+            static_cast<long long>(in[1] * 0x0101010101010101ULL), static_cast<long long>(in[0] * 0x0101010101010101ULL));
+        __m256i set = _mm256_cmpeq_epi8(_mm256_and_si256(spread, select256), select256);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(bits.data() + i), _mm256_and_si256(set, one256));
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i select128 = _mm_set1_epi64x(static_cast<long long>(0x8040201008040201ULL));
+    const __m128i one128 = _mm_set1_epi8(1);
+    for (; i + 16 <= bits.size(); i += 16) {
+        const std::uint8_t* in = packed.data() + i / 8;
+        __m128i spread = _mm_set_epi64x(
+            static_cast<long long>(in[1] * 0x0101010101010101ULL), static_cast<long long>(in[0] * 0x0101010101010101ULL));
+        __m128i set = _mm_cmpeq_epi8(_mm_and_si128(spread, select128), select128);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(bits.data() + i), _mm_and_si128(set, one128));
+    }
+#endif
+    scalar::unpack_bits(packed.subspan(i / 8), bits.subspan(i));
+}
+
+/**
+ * @brief Swap the bytes of count 16-bit words (in and out may be the same buffer)
+ *
+ * Uses AVX2 or SSSE3 pshufb (16/8 words per step), SSE2 shifts, or bswap.
+ */
+inline void swap_bytes_16(const std::uint8_t* in, std::uint8_t* out, size_t count) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i swap256 = _mm256_setr_epi8(
+        1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+        1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    for (; i + 16 <= count; i += 16) {
+        __m256i words = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i * 2));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i * 2), _mm256_shuffle_epi8(words, swap256));
+    }
+#endif
+#if defined(__SSSE3__)
+    const __m128i swap128 = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    for (; i + 8 <= count; i += 8) {
+        __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 2));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2), _mm_shuffle_epi8(words, swap128));
+    }
+#elif defined(__SSE2__)
+    for (; i + 8 <= count; i += 8) {
+        __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 2));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2), _mm_or_si128(_mm_slli_epi16(words, 8), _mm_srli_epi16(words, 8)));
+    }
+#endif
+    scalar::swap_bytes_16(in + i * 2, out + i * 2, count - i);
+}
+
+/**
+ * @brief Convert host registers into the big endian wire format
+ *
+ * @param values register values (host endian)
+ * @param wire output, at least values.size() * 2 bytes
+ */
+inline void store_big_endian(std::span<const std::uint16_t> values, std::span<std::uint8_t> wire) {
+    auto in = reinterpret_cast<const std::uint8_t*>(values.data());
+    if constexpr (std::endian::native == std::endian::big) {
+        std::memcpy(wire.data(), in, values.size() * 2);
+    } else {
+        swap_bytes_16(in, wire.data(), values.size());
+    }
+}
+
+/**
+ * @brief Convert big endian wire registers into host registers
+ *
+ * @param wire registers as sent on the wire, at least values.size() * 2 bytes
+ * @param values output (host endian)
+ */
+inline void load_big_endian(std::span<const std::uint8_t> wire, std::span<std::uint16_t> values) {
+    auto out = reinterpret_cast<std::uint8_t*>(values.data());
+    if constexpr (std::endian::native == std::endian::big) {
+        std::memcpy(out, wire.data(), values.size() * 2);
+    } else {
+        swap_bytes_16(wire.data(), out, values.size());
+    }
+}
+
+/**
+ * @brief Convert host registers into the big endian wire format in place
+ *
+ * @param values register values (host endian), big endian on return
+ * @return the same memory seen as wire bytes
+ */
+inline std::span<const std::uint8_t> to_big_endian_in_place(std::span<std::uint16_t> values) {
+    auto bytes = reinterpret_cast<std::uint8_t*>(values.data());
+    if constexpr (std::endian::native == std::endian::little) {
+        swap_bytes_16(bytes, bytes, values.size());
+    }
+    return std::span<const std::uint8_t>(bytes, values.size() * 2);
+}
+
+} // namespace modbus::simd
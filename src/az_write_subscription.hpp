@@ -0,0 +1,229 @@
+#pragma once
+
+#include "az_database_interface.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace modbus {
+
+/**
+ * @brief Bounded lock-free queue, many producers and one consumer
+ *
+ * Every cell carries a sequence number telling whether it is free for the
+ * producer of a position or filled for the consumer, so push and pop never
+ * take a lock and producers only contend on the tail index.
+ */
+template <typename T>
+class BoundedQueue {
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+    alignas(64) std::atomic<size_t> tail_{0};
+    alignas(64) std::atomic<size_t> head_{0};
+
+public:
+    /**
+     * @param capacity number of elements, rounded up to a power of two
+     */
+    explicit BoundedQueue(size_t capacity)
+        : cells_(std::make_unique<Cell[]>(std::bit_ceil(std::max<size_t>(capacity, 2)))),
+          mask_(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1) {
+        for (size_t i = 0; i <= mask_; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    size_t capacity() const {
+        return mask_ + 1;
+    }
+
+    /**
+     * @brief Append a value, safe from any number of threads
+     *
+     * @return false when the queue is full
+     */
+    bool try_push(const T& value) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells_[pos & mask_];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Remove the oldest value, from the single consumer thread only
+     *
+     * @return false when the queue is empty
+     */
+    bool try_pop(T& value) {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        Cell& cell = cells_[pos & mask_];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        if (static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos + 1) < 0) {
+            return false;
+        }
+        value = cell.value;
+        cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+        head_.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+};
+
+/**
+ * @brief Addresses [start, start + count) of one table written by a master
+ *
+ * Addresses are database addresses (the request address minus one), the new
+ * values are read from the database.
+ */
+struct WriteEvent {
+    std::uint8_t unit_id = 0;
+    db::DbType type = db::DbType::REGISTER;
+    std::uint16_t start = 0;
+    std::uint32_t count = 0;
+};
+
+/**
+ * @brief Write notifications for an address range of one unit and table
+ *
+ * Created by ModbusServer::subscribe_writes(). The server publishes every
+ * write overlapping the range from its I/O threads, clipped to the range,
+ * into a bounded lock-free queue; the consumer collects them with drain(),
+ * which coalesces the batch so each address is reported once. When the queue
+ * overflows, the next batch reports the whole range instead of losing writes.
+ */
+class WriteSubscription {
+private:
+    std::uint8_t unit_id_;
+    db::DbType type_;
+    std::uint32_t start_;
+    std::uint32_t end_;
+    BoundedQueue<WriteEvent> queue_;
+    std::atomic<bool> overflowed_{false};
+    // Bumped by every publish, waited on by wait().
+    std::atomic<std::uint32_t> signal_{0};
+    std::atomic<bool> closed_{false};
+
+public:
+    /**
+     * @param unit_id unit whose writes are reported
+     * @param type BITS (coils) or REGISTER (holding registers), the tables masters write
+     * @param start first database address
+     * @param count number of addresses
+     * @param capacity queued events before an overflow
+     */
+    WriteSubscription(std::uint8_t unit_id, db::DbType type, std::uint16_t start, std::uint32_t count, size_t capacity)
+        : unit_id_(unit_id), type_(type), start_(start), end_(std::min<std::uint32_t>(start + count, 0x10000)),
+          queue_(capacity) {}
+
+    /**
+     * @brief Report a write, called by the server; writes outside the range are ignored
+     */
+    void publish(std::uint8_t unit_id, db::DbType type, std::uint16_t start, size_t count) {
+        if (unit_id != unit_id_ || type != type_) return;
+        std::uint32_t first = std::max<std::uint32_t>(start, start_);
+        std::uint32_t last = std::min<std::uint32_t>(static_cast<std::uint32_t>(start + count), end_);
+        if (first >= last) return;
+
+        if (!queue_.try_push(WriteEvent{unit_id, type, static_cast<std::uint16_t>(first), last - first})) {
+            overflowed_.store(true, std::memory_order_release);
+        }
+        signal_.fetch_add(1, std::memory_order_release);
+        signal_.notify_one();
+    }
+
+    /**
+     * @brief Collect the writes published since the last call, one consumer thread at a time
+     *
+     * Overlapping and adjacent ranges are merged, so every written address
+     * appears in exactly one event, in address order.
+     *
+     * @param batch cleared, then filled with the coalesced events
+     * @return number of events in batch
+     */
+    size_t drain(std::vector<WriteEvent>& batch) {
+        batch.clear();
+        WriteEvent event;
+        while (queue_.try_pop(event)) {
+            batch.push_back(event);
+        }
+        if (overflowed_.exchange(false, std::memory_order_acquire)) {
+            batch.assign(1, WriteEvent{unit_id_, type_, static_cast<std::uint16_t>(start_), end_ - start_});
+            return batch.size();
+        }
+        if (batch.size() < 2) return batch.size();
+
+        std::sort(batch.begin(), batch.end(), [](const WriteEvent& a, const WriteEvent& b) { return a.start < b.start; });
+        size_t merged = 0;
+        for (size_t i = 1; i < batch.size(); ++i) {
+            auto& last = batch[merged];
+            std::uint32_t last_end = last.start + last.count;
+            if (batch[i].start <= last_end) {
+                last.count = std::max(last_end, batch[i].start + batch[i].count) - last.start;
+            }
+            else {
+                batch[++merged] = batch[i];
+            }
+        }
+        batch.resize(merged + 1);
+        return batch.size();
+    }
+
+    /**
+     * @brief Block until a write is published after seen, or close() is called
+     *
+     * @param seen value returned by the previous wait() (0 initially)
+     * @return value to pass to the next wait()
+     */
+    std::uint32_t wait(std::uint32_t seen) {
+        while (signal_.load(std::memory_order_acquire) == seen && !closed_.load(std::memory_order_acquire)) {
+            signal_.wait(seen, std::memory_order_acquire);
+        }
+        return signal_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Wake the consumer blocked in wait(), e.g. on shutdown
+     */
+    void close() {
+        closed_.store(true, std::memory_order_release);
+        signal_.fetch_add(1, std::memory_order_release);
+        signal_.notify_all();
+    }
+
+    bool closed() const {
+        return closed_.load(std::memory_order_acquire);
+    }
+
+    std::uint8_t unit_id() const {
+        return unit_id_;
+    }
+
+    db::DbType type() const {
+        return type_;
+    }
+};
+
+} // namespace modbus
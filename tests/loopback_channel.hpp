@@ -0,0 +1,93 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+#include "../src/az_modbus_transport_awaitable.hpp"
+
+/**
+ * @brief In-memory channel: writes go to a responder callback, the peer bytes are pushed back with push()
+ */
+class LoopbackChannel : public modbus::IModbusChannel {
+private:
+    asio::any_io_executor executor_;
+    std::vector<std::uint8_t> rx_;
+    asio::steady_timer rx_signal_;
+    bool closed_ = false;
+
+public:
+    // Every write, in order (requests of a client, responses of a server).
+    std::vector<std::vector<std::uint8_t>> written;
+    std::function<void(LoopbackChannel&, const std::vector<std::uint8_t>&)> responder;
+
+    explicit LoopbackChannel(asio::io_context& io)
+        : executor_(io.get_executor()), rx_signal_(io, asio::steady_timer::time_point::max()) {}
+
+    void push(std::span<const std::uint8_t> bytes) {
+        rx_.insert(rx_.end(), bytes.begin(), bytes.end());
+        rx_signal_.cancel();
+    }
+
+    std::future<void> connect(const std::string&, const std::string&) override {
+        std::promise<void> done;
+        done.set_value();
+        return done.get_future();
+    }
+
+    std::future<size_t> write(const std::vector<std::uint8_t>& data) override {
+        return co_spawn(executor_, co_write(data), asio::use_future);
+    }
+
+    std::future<std::vector<std::uint8_t>> read(size_t bytes_to_read) override {
+        return co_spawn(executor_, co_read(bytes_to_read), asio::use_future);
+    }
+
+    std::future<size_t> read_some(std::span<std::uint8_t> buffer) override {
+        return co_spawn(executor_, co_read_some(buffer), asio::use_future);
+    }
+
+    modbus::awaitable<void> co_connect(const std::string&, const std::string&) override {
+        co_return;
+    }
+
+    modbus::awaitable<std::vector<std::uint8_t>> co_read(size_t bytes_to_read) override {
+        std::vector<std::uint8_t> buffer(bytes_to_read);
+        size_t offset = 0;
+        while (offset < bytes_to_read) {
+            offset += co_await co_read_some(std::span<std::uint8_t>(buffer).subspan(offset));
+        }
+        co_return buffer;
+    }
+
+    modbus::awaitable<size_t> co_read_some(std::span<std::uint8_t> buffer) override {
+        while (rx_.empty() && !closed_) {
+            asio::error_code ec;
+            co_await rx_signal_.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+        }
+        if (rx_.empty()) {
+            throw std::runtime_error("End of file");
+        }
+        size_t count = std::min(buffer.size(), rx_.size());
+        std::copy_n(rx_.begin(), count, buffer.begin());
+        rx_.erase(rx_.begin(), rx_.begin() + count);
+        co_return count;
+    }
+
+    modbus::awaitable<size_t> co_write(const std::vector<std::uint8_t>& data) override {
+        written.push_back(data);
+        if (responder) {
+            responder(*this, data);
+        }
+        co_return data.size();
+    }
+
+    asio::any_io_executor get_executor() override {
+        return executor_;
+    }
+
+    void close() override {
+        closed_ = true;
+        rx_signal_.cancel();
+    }
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vector>
+#include <future>
+
+#include "../src/az_modbus_server.hpp"
+#include "../src/az_register_bank.hpp"
+
+#include "loopback_channel.hpp"
+
+/**
+ * @brief Server transport handing in-memory connections to the server
+ */
+class LoopbackServerTransport : public modbus::IServerTransport {
+public:
+    NewConnectionHandler handler;
+
+    std::future<void> start_accepting(const std::string&, const std::string&, NewConnectionHandler new_connection) override {
+        handler = std::move(new_connection);
+        return {};
+    }
+};
+
+/**
+ * @brief ModbusServer fed with raw bytes through LoopbackChannel connections
+ */
+class LoopbackServer {
+private:
+    LoopbackServerTransport* transport_;
+
+    explicit LoopbackServer(std::unique_ptr<LoopbackServerTransport> transport)
+        : transport_(transport.get()), server(std::move(transport)) {}
+
+public:
+    modbus::ModbusServer server;
+
+    LoopbackServer() : LoopbackServer(std::make_unique<LoopbackServerTransport>()) {}
+
+    // Adds a RegisterBank unit, it stays owned by the server.
+    db::RegisterBank& add_unit(std::uint8_t unit_id) {
+        auto bank = std::make_unique<db::RegisterBank>();
+        auto& unit = *bank;
+        server.add_unit(modbus::UnitID(unit_id), std::move(bank));
+        return unit;
+    }
+
+    void start() {
+        server.start(modbus::Ipv4("127.0.0.1"), modbus::Port("502"));
+    }
+
+    /**
+     * @brief Send bytes on a new connection, received in a single read, and close it
+     *
+     * @return every write of the server on the connection
+     */
+    std::vector<std::vector<std::uint8_t>> serve(const std::vector<std::uint8_t>& bytes) {
+        asio::io_context io;
+        std::vector<std::vector<std::uint8_t>> written;
+        auto channel = std::make_unique<LoopbackChannel>(io);
+        channel->responder = [&written](LoopbackChannel&, const std::vector<std::uint8_t>& data) {
+            written.push_back(data);
+        };
+        channel->push(bytes);
+        channel->close();
+        transport_->handler(std::move(channel));
+        io.run();
+        return written;
+    }
+};
+
+// Concatenates frames, as a master pipelining them sends them.
+inline std::vector<std::uint8_t> join(std::initializer_list<std::vector<std::uint8_t>> frames) {
+    std::vector<std::uint8_t> bytes;
+    for (const auto& frame : frames) {
+        bytes.insert(bytes.end(), frame.begin(), frame.end());
+    }
+    return bytes;
+}
@@ -0,0 +1,325 @@
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+#include "../src/az_modbus_context.hpp"
+#include "../src/az_modbus_protocol.hpp"
+#include "../src/az_modbus_pipeline.hpp"
+#include "../src/az_modbus_async_client.hpp"
+#include "../src/az_modbus_client.hpp"
+#include "../src/az_asio_channel.hpp"
+
+#include "loopback_channel.hpp"
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+// Answers a read holding registers request with one register holding the TID.
+static std::vector<std::uint8_t> tid_response(const std::vector<std::uint8_t>& request) {
+    auto header = modbus::decode_header(request);
+    modbus::RequestData pdu_data{modbus::FunctionCode::HoldingRegisters, 0u, 1u, 0u};
+    std::vector<std::uint16_t> registers = {header.transaction_id};
+    return modbus::handle_read_registers(header, pdu_data, registers);
+}
+
+TEST_CASE("Pipeline matches out of order responses by TID") {
+    asio::io_context io;
+    auto channel = std::make_shared<LoopbackChannel>(io);
+
+    // Hold every request and answer the whole burst in reverse order.
+    channel->responder = [](LoopbackChannel& self, const std::vector<std::uint8_t>&) {
+        if (self.written.size() < 4) return;
+        std::vector<std::uint8_t> burst;
+        for (auto it = self.written.rbegin(); it != self.written.rend(); ++it) {
+            auto response = tid_response(*it);
+            burst.insert(burst.end(), response.begin(), response.end());
+        }
+        self.push(burst);
+    };
+
+    auto pipeline = std::make_shared<modbus::TransactionPipeline>(channel, 8);
+    std::vector<std::uint16_t> results;
+    size_t outstanding = 0;
+
+    co_spawn(io, [&]() -> modbus::awaitable<void> {
+        std::vector<modbus::TransactionPipeline::TransactionPtr> transactions;
+        for (int i = 0; i < 4; ++i) {
+            transactions.push_back(co_await pipeline->co_submit(
+                modbus::create_read_adu(0, 1, 0, 1, modbus::FunctionCode::HoldingRegisters)));
+        }
+        outstanding = pipeline->in_flight();
+
+        for (auto& transaction : transactions) {
+            auto response = co_await pipeline->co_result(transaction);
+            auto registers = modbus::decode_read_register_view(modbus::MbapHeaderView(response).pdu());
+            results.push_back(registers[0]);
+        }
+    }, asio::detached);
+    io.run();
+
+    REQUIRE(outstanding == 4u);
+    REQUIRE(channel->written.size() == 4u);
+    REQUIRE((results == std::vector<std::uint16_t>{0, 1, 2, 3}));
+    REQUIRE(pipeline->in_flight() == 0u);
+}
+
+TEST_CASE("Pipeline bounds the number of outstanding requests") {
+    asio::io_context io;
+    auto channel = std::make_shared<LoopbackChannel>(io);
+    size_t max_seen = 0;
+
+    std::shared_ptr<modbus::TransactionPipeline> pipeline;
+    channel->responder = [&](LoopbackChannel& self, const std::vector<std::uint8_t>& request) {
+        max_seen = std::max(max_seen, pipeline->in_flight());
+        self.push(tid_response(request));
+    };
+    pipeline = std::make_shared<modbus::TransactionPipeline>(channel, 2);
+
+    int completed = 0;
+    for (int i = 0; i < 10; ++i) {
+        co_spawn(io, [&]() -> modbus::awaitable<void> {
+            co_await pipeline->co_transact(modbus::create_read_adu(0, 1, 0, 1, modbus::FunctionCode::HoldingRegisters));
+            completed++;
+        }, asio::detached);
+    }
+    io.run();
+
+    REQUIRE(completed == 10);
+    REQUIRE(max_seen <= 2u);
+}
+
+TEST_CASE("Pipeline fails outstanding requests when the connection drops") {
+    asio::io_context io;
+    auto channel = std::make_shared<LoopbackChannel>(io);
+    channel->responder = [](LoopbackChannel& self, const std::vector<std::uint8_t>&) { self.close(); };
+
+    auto pipeline = std::make_shared<modbus::TransactionPipeline>(channel, 4);
+    bool failed = false;
+
+    co_spawn(io, [&]() -> modbus::awaitable<void> {
+        try {
+            co_await pipeline->co_transact(modbus::create_read_adu(0, 1, 0, 1, modbus::FunctionCode::HoldingRegisters));
+        } catch (const std::runtime_error&) {
+            failed = true;
+        }
+    }, asio::detached);
+    io.run();
+
+    REQUIRE(failed == true);
+}
+
+TEST_CASE("Async client reads and writes through awaitables") {
+    asio::io_context io;
+    auto channel = std::make_unique<LoopbackChannel>(io);
+
+    // Writes are echoed, reads return registers counting up from the start address.
+    channel->responder = [](LoopbackChannel& self, const std::vector<std::uint8_t>& request) {
+        auto header = modbus::decode_header(request);
+        auto data = std::get<modbus::RequestData>(modbus::decode_request(modbus::MbapHeaderView(request).pdu()));
+        if (data.func_code == modbus::FunctionCode::WriteSingleRegister) {
+            self.push(request);
+            return;
+        }
+        std::vector<std::uint16_t> registers(data.number);
+        for (std::uint16_t i = 0; i < data.number; ++i) {
+            registers[i] = data.start_addr + i;
+        }
+        self.push(modbus::handle_read_registers(header, data, registers));
+    };
+
+    modbus::AsyncModbusClient client(std::move(channel));
+    std::vector<std::uint16_t> registers;
+
+    co_spawn(io, [&]() -> modbus::awaitable<void> {
+        co_await client.co_connect(modbus::Ipv4("127.0.0.1"), modbus::Port("502"));
+        co_await client.co_write_single_register(1, 10, 200);
+        registers = co_await client.co_read_holding_registers(1, 10, 3);
+    }, asio::detached);
+    io.run();
+
+    REQUIRE((registers == std::vector<std::uint16_t>{10, 11, 12}));
+}
+
+TEST_CASE("Async client rejects a register response shorter than requested") {
+    asio::io_context io;
+    auto channel = std::make_unique<LoopbackChannel>(io);
+
+    // Answers with one register less than requested.
+    channel->responder = [](LoopbackChannel& self, const std::vector<std::uint8_t>& request) {
+        auto header = modbus::decode_header(request);
+        auto data = std::get<modbus::RequestData>(modbus::decode_request(modbus::MbapHeaderView(request).pdu()));
+        std::vector<std::uint16_t> registers(data.number - 1, 0x1234);
+        data.number = static_cast<std::uint16_t>(registers.size());
+        self.push(modbus::handle_read_registers(header, data, registers));
+    };
+
+    modbus::AsyncModbusClient client(std::move(channel));
+    bool failed = false;
+
+    co_spawn(io, [&]() -> modbus::awaitable<void> {
+        co_await client.co_connect(modbus::Ipv4("127.0.0.1"), modbus::Port("502"));
+        try {
+            co_await client.co_read_holding_registers(1, 10, 3);
+        }
+        catch (const std::runtime_error&) {
+            failed = true;
+        }
+    }, asio::detached);
+    io.run();
+
+    REQUIRE(failed == true);
+}
+
+TEST_CASE("Client checks the unit ID and register count of FC 0x17 responses") {
+    asio::io_context io;
+    auto work = asio::make_work_guard(io);
+    std::thread io_thread([&io] { io.run(); });
+    auto channel = std::make_unique<LoopbackChannel>(io);
+    std::vector<std::vector<std::uint8_t>> responses = {
+        //   tid         prot_id     length      unit  fc    bytes  registers
+        {0x00, 0x00, 0x00, 0x00, 0x00, 0x07, 0x02, 0x17, 0x04, 0x00, 0x01, 0x00, 0x02},
+        {0x00, 0x01, 0x00, 0x00, 0x00, 0x05, 0x01, 0x17, 0x02, 0x00, 0x01},
+        {0x00, 0x02, 0x00, 0x00, 0x00, 0x07, 0x01, 0x17, 0x04, 0x00, 0x01, 0x00, 0x02},
+    };
+    channel->responder = [&responses](LoopbackChannel& self, const std::vector<std::uint8_t>&) {
+        self.push(responses.front());
+        responses.erase(responses.begin());
+    };
+
+    modbus::ModbusClient client(std::move(channel));
+    std::vector<std::uint16_t> values = {0x1234};
+    CHECK_THROWS(client.read_write_registers(1, 0, 2, 10, values));
+    CHECK_THROWS(client.read_write_registers(1, 0, 2, 10, values));
+    CHECK(client.read_write_registers(1, 0, 2, 10, values) == std::vector<std::uint16_t>{1, 2});
+
+    work.reset();
+    io_thread.join();
+}
+
+TEST_CASE("ModbusContext hands out its io_contexts round robin") {
+    modbus::ModbusContext context(3);
+    REQUIRE(context.size() == 3u);
+
+    std::vector<asio::io_context*> handed_out;
+    for (int i = 0; i < 6; ++i) {
+        handed_out.push_back(&context.next_io_context());
+    }
+    REQUIRE(handed_out[0] != handed_out[1]);
+    REQUIRE(handed_out[1] != handed_out[2]);
+    REQUIRE(handed_out[0] == handed_out[3]);
+    REQUIRE(handed_out[2] == handed_out[5]);
+
+    // Every worker thread runs its loop.
+    std::vector<std::future<std::thread::id>> ids;
+    for (size_t i = 0; i < context.size(); ++i) {
+        ids.push_back(asio::post(context.get_io_context(i), asio::use_future([] { return std::this_thread::get_id(); })));
+    }
+    REQUIRE(ids[0].get() != ids[1].get());
+}
+
+TEST_CASE("Async client splits long register writes into pipelined requests") {
+    asio::io_context io;
+    auto channel = std::make_unique<LoopbackChannel>(io);
+    auto* loopback = channel.get();
+    std::vector<std::uint16_t> device(300);
+
+    channel->responder = [&device](LoopbackChannel& self, const std::vector<std::uint8_t>& request) {
+        auto data = std::get<modbus::RequestData>(modbus::decode_request(modbus::MbapHeaderView(request).pdu()));
+        std::vector<std::uint16_t> values(data.number);
+        modbus::simd::load_big_endian(data.payload, values);
+        std::copy(values.begin(), values.end(), device.begin() + data.start_addr);
+
+        modbus::AduFrame response;
+        size_t size = modbus::encode_write_multiple_response(response, modbus::decode_header(request), data);
+        self.push(std::span<const std::uint8_t>(response).first(size));
+    };
+
+    modbus::AsyncModbusClient client(std::move(channel), 4);
+    std::vector<std::uint16_t> recipe(250);
+    for (size_t i = 0; i < recipe.size(); ++i) recipe[i] = static_cast<std::uint16_t>(i + 1);
+    bool done = false;
+
+    co_spawn(io, [&]() -> modbus::awaitable<void> {
+        co_await client.co_write_multiple_registers(1, 10, recipe);
+        done = true;
+    }, asio::detached);
+    io.run();
+
+    REQUIRE(done == true);
+    REQUIRE(loopback->written.size() == 3u);
+    REQUIRE(std::equal(recipe.begin(), recipe.end(), device.begin() + 10));
+}
+
+TEST_CASE("Buffered channel coalesces queued writes and serves reads from its buffer") {
+    asio::io_context io;
+    asio::ip::tcp::acceptor acceptor(io, asio::ip::tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    asio::ip::tcp::socket socket(io);
+    socket.connect(acceptor.local_endpoint());
+    modbus::AsioChannel server(acceptor.accept(), modbus::ChannelMode::Buffered);
+    modbus::AsioChannel client(std::move(socket), modbus::ChannelMode::Buffered);
+
+    std::vector<std::vector<std::uint8_t>> frames = {{1, 2, 3}, {4, 5}, {6, 7, 8, 9}};
+    std::vector<std::uint8_t> header;
+    std::vector<std::uint8_t> body;
+    std::array<std::uint8_t, 16> tail{};
+    size_t tail_size = 0;
+
+    // The first writer sends, the next two are queued while it is in flight.
+    // Every call returns once its frame was written.
+    std::vector<size_t> sent_after;
+    for (const auto& frame : frames) {
+        asio::co_spawn(io, [&]() -> asio::awaitable<void> {
+            co_await client.co_write(frame);
+            sent_after.push_back(client.socket_writes());
+        }, asio::detached);
+    }
+    asio::co_spawn(io, [&]() -> asio::awaitable<void> {
+        co_await client.co_write_batch(frames);
+        sent_after.push_back(client.socket_writes());
+        header = co_await server.co_read(2);
+        body = co_await server.co_read(7);
+        while (tail_size < 9) {
+            tail_size += co_await server.co_read_some(std::span<std::uint8_t>(tail).subspan(tail_size));
+        }
+    }, asio::detached);
+    io.run();
+
+    // The first frame is sent alone, the two frames and the batch queued behind it with one more write.
+    REQUIRE(client.socket_writes() == 2u);
+    REQUIRE((sent_after == std::vector<size_t>{2, 2, 2, 2}));
+    REQUIRE((header == std::vector<std::uint8_t>{1, 2}));
+    REQUIRE((body == std::vector<std::uint8_t>{3, 4, 5, 6, 7, 8, 9}));
+    REQUIRE(tail_size == 9u);
+    REQUIRE((std::vector<std::uint8_t>(tail.begin(), tail.begin() + 9) == std::vector<std::uint8_t>{1, 2, 3, 4, 5, 6, 7, 8, 9}));
+}
+
+TEST_CASE("Buffered channel fails the writes queued behind a failed socket write") {
+    asio::io_context io;
+    asio::ip::tcp::acceptor acceptor(io, asio::ip::tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0));
+    asio::ip::tcp::socket socket(io);
+    socket.connect(acceptor.local_endpoint());
+    modbus::AsioChannel client(std::move(socket), modbus::ChannelMode::Buffered);
+
+    std::vector<std::vector<std::uint8_t>> frames = {{1, 2, 3}, {4, 5}, {6, 7, 8, 9}};
+    size_t failed = 0;
+    auto write = [&](const std::vector<std::uint8_t>& frame) -> asio::awaitable<void> {
+        try {
+            co_await client.co_write(frame);
+        }
+        catch (const std::exception&) {
+            ++failed;
+        }
+    };
+    for (const auto& frame : frames) {
+        asio::co_spawn(io, write(frame), asio::detached);
+    }
+    client.close();
+    io.run();
+    REQUIRE(failed == frames.size());
+
+    // Later writes get the error as well.
+    io.restart();
+    asio::co_spawn(io, write(frames[0]), asio::detached);
+    io.run();
+    REQUIRE(failed == frames.size() + 1);
+}
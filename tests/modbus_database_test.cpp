@@ -0,0 +1,473 @@
+#include <vector>
+#include <algorithm>
+#include <variant>
+#include <stdexcept>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <random>
+#include <filesystem>
+#include <chrono>
+#include <future>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../src/az_modbus_protocol.hpp"
+
+#include "../src/az_database_interface.hpp"
+#include "../src/az_register_bank.hpp"
+#include "../src/az_bit_table.hpp"
+#include "../src/az_mapped_register_bank.hpp"
+#include "../src/az_shared_register_bank.hpp"
+#include "../src/az_write_subscription.hpp"
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+/**
+ * @brief Per element database relying on the default bulk implementations
+ */
+class ElementDatabase : public db::DatabaseInterface {
+public:
+    std::vector<std::uint8_t> bits = std::vector<std::uint8_t>(64);
+    std::vector<std::uint16_t> registers = std::vector<std::uint16_t>(64);
+
+    bool connect() override { return true; }
+    bool release() override { return true; }
+    bool db_create(std::uint16_t) override { return true; }
+    bool db_delete(db::DbType, std::uint16_t) override { return true; }
+
+    std::variant<std::uint8_t, std::uint16_t> db_read(db::DbType type, std::uint16_t id) override {
+        if (type == db::DbType::BITS) return bits.at(id);
+        return registers.at(id);
+    }
+
+    bool db_update(db::DbType type, std::uint16_t id, std::variant<std::uint8_t, std::uint16_t> value) override {
+        if (type == db::DbType::BITS) bits.at(id) = std::get<std::uint8_t>(value);
+        else registers.at(id) = std::get<std::uint16_t>(value);
+        return true;
+    }
+};
+
+TEST_CASE("Default bulk register access falls back to per element calls") {
+    ElementDatabase database;
+    std::vector<std::uint16_t> values = {10, 20, 30};
+
+    REQUIRE(database.db_write_range(db::DbType::REGISTER, 5, values) == true);
+    REQUIRE(database.registers[5] == 10u);
+    REQUIRE(database.registers[7] == 30u);
+
+    std::vector<std::uint16_t> read_back(3);
+    REQUIRE(database.db_read_range(db::DbType::REGISTER, 5, read_back) == true);
+    REQUIRE(read_back == values);
+
+    std::vector<std::uint16_t> too_far(2);
+    REQUIRE(database.db_read_range(db::DbType::REGISTER, 0xFFFF, too_far) == false);
+}
+
+TEST_CASE("Default bulk bit access uses the Modbus packed layout") {
+    ElementDatabase database;
+    std::vector<std::uint8_t> packed = {0xCD, 0x01};
+
+    REQUIRE(database.db_write_bits(db::DbType::BITS, 3, 10, packed) == true);
+    std::vector<std::uint8_t> expected = {1, 0, 1, 1, 0, 0, 1, 1, 1, 0};
+    REQUIRE(std::equal(expected.begin(), expected.end(), database.bits.begin() + 3));
+
+    std::vector<std::uint8_t> read_back(2, 0xFF);
+    REQUIRE(database.db_read_bits(db::DbType::BITS, 3, 10, read_back) == true);
+    REQUIRE(read_back == packed);
+}
+
+TEST_CASE("Register bank covers the full address space") {
+    db::RegisterBank bank;
+    REQUIRE(bank.db_create(0) == true);
+
+    REQUIRE(bank.db_update(db::DbType::REGISTER, 0xFFFF, std::uint16_t{0xBEEF}) == true);
+    REQUIRE(std::get<std::uint16_t>(bank.db_read(db::DbType::REGISTER, 0xFFFF)) == 0xBEEF);
+    REQUIRE(std::get<std::uint16_t>(bank.db_read(db::DbType::REGISTER_INPUT, 0xFFFF)) == 0u);
+
+    REQUIRE(bank.db_update(db::DbType::BITS_INPUT, 0xFFFF, std::uint8_t{1}) == true);
+    REQUIRE(std::get<std::uint8_t>(bank.db_read(db::DbType::BITS_INPUT, 0xFFFF)) == 1u);
+    REQUIRE(std::get<std::uint8_t>(bank.db_read(db::DbType::BITS, 0xFFFF)) == 0u);
+
+    std::vector<std::uint16_t> values = {1, 2, 3};
+    REQUIRE(bank.db_write_range(db::DbType::REGISTER_INPUT, 0xFFFD, values) == true);
+    REQUIRE(bank.db_write_range(db::DbType::REGISTER_INPUT, 0xFFFE, values) == false);
+
+    std::vector<std::uint16_t> read_back(3);
+    REQUIRE(bank.db_read_range(db::DbType::REGISTER_INPUT, 0xFFFD, read_back) == true);
+    REQUIRE(read_back == values);
+    REQUIRE(bank.db_read_range(db::DbType::BITS, 0, read_back) == false);
+
+    std::vector<std::uint8_t> packed = {0xCD, 0x01};
+    REQUIRE(bank.db_write_bits(db::DbType::BITS, 0xFFF0, 10, packed) == true);
+    std::vector<std::uint8_t> bits_back(2, 0xFF);
+    REQUIRE(bank.db_read_bits(db::DbType::BITS, 0xFFF0, 10, bits_back) == true);
+    // The padding bits of the last byte are cleared, whatever the buffer held.
+    REQUIRE((bits_back[0] == 0xCD && bits_back[1] == 0x01));
+    REQUIRE(bank.db_read_bits(db::DbType::BITS, 0xFFF0, 17, bits_back) == false);
+}
+
+TEST_CASE("Register bank bit reads on either side of the stack snapshot size") {
+    db::RegisterBank bank;
+    // Every third coil set, from address 0 to the end of the table.
+    std::vector<std::uint8_t> pattern(db::REGISTER_BANK_SIZE / 8);
+    for (size_t i = 0; i < db::REGISTER_BANK_SIZE; i += 3) {
+        pattern[i / 8] |= static_cast<std::uint8_t>(1 << (i % 8));
+    }
+    REQUIRE(bank.db_write_bits(db::DbType::BITS, 0, 0xFFFF, pattern) == true);
+
+    for (std::uint16_t count : {std::uint16_t{2000}, std::uint16_t{2200}, std::uint16_t{0xFFFF - 63}}) {
+        std::vector<std::uint8_t> packed((count + 7) / 8);
+        REQUIRE(bank.db_read_bits(db::DbType::BITS, 63, count, packed) == true);
+        for (size_t i = 0; i < count; ++i) {
+            REQUIRE(((packed[i / 8] >> (i % 8)) & 1) == ((63 + i) % 3 == 0 ? 1 : 0));
+        }
+    }
+}
+
+TEST_CASE("Register bank range reads never observe a torn range write") {
+    db::RegisterBank bank;
+    constexpr size_t range = 125;
+    std::atomic<bool> stop{false};
+    std::atomic<int> torn{0};
+
+    std::thread writer([&] {
+        std::vector<std::uint16_t> values(range);
+        for (std::uint16_t round = 1; round < 5000; ++round) {
+            std::fill(values.begin(), values.end(), round);
+            bank.db_write_range(db::DbType::REGISTER, 100, values);
+        }
+        stop = true;
+    });
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&] {
+            std::vector<std::uint16_t> snapshot(range);
+            while (!stop) {
+                bank.db_read_range(db::DbType::REGISTER, 100, snapshot);
+                if (std::adjacent_find(snapshot.begin(), snapshot.end(), std::not_equal_to<>()) != snapshot.end()) {
+                    torn++;
+                }
+            }
+        });
+    }
+
+    writer.join();
+    for (auto& reader : readers) reader.join();
+
+    REQUIRE(torn == 0);
+    REQUIRE(std::get<std::uint16_t>(bank.db_read(db::DbType::REGISTER, 224)) == 4999u);
+}
+
+TEST_CASE("BitTable word kernels match a one byte per bit reference") {
+    std::mt19937 rng(7);
+    db::BitTable table(1000);
+    std::vector<std::uint8_t> reference(1000, 0);
+
+    for (int round = 0; round < 200; ++round) {
+        size_t start = rng() % 1000;
+        size_t count = 1 + rng() % std::min<size_t>(1000 - start, 300);
+
+        std::vector<std::uint8_t> packed((count + 7) / 8);
+        for (auto& byte : packed) byte = static_cast<std::uint8_t>(rng());
+        REQUIRE(table.write_packed(start, count, packed) == true);
+        for (size_t i = 0; i < count; ++i) {
+            reference[start + i] = (packed[i / 8] >> (i % 8)) & 0x01;
+        }
+
+        size_t read_start = rng() % 1000;
+        size_t read_count = 1 + rng() % (1000 - read_start);
+        std::vector<std::uint8_t> read_back((read_count + 7) / 8, 0xFF);
+        REQUIRE(table.read_packed(read_start, read_count, read_back) == true);
+        for (size_t i = 0; i < read_count; ++i) {
+            REQUIRE(((read_back[i / 8] >> (i % 8)) & 0x01) == reference[read_start + i]);
+        }
+        // Padding bits of the last byte are zero, as the protocol requires.
+        if (read_count % 8) REQUIRE((read_back.back() >> (read_count % 8)) == 0);
+    }
+    REQUIRE(table.get(999) == (reference[999] != 0));
+    std::vector<std::uint8_t> past_end(2);
+    REQUIRE(table.read_packed(990, 11, past_end) == false);
+}
+
+TEST_CASE("Table generations change on every write") {
+    db::RegisterBank bank;
+    std::array<std::uint16_t, 2> values = {0x1234, 0x5678};
+    auto generation = bank.db_generation(db::DbType::REGISTER);
+    REQUIRE(generation.has_value());
+    CHECK(bank.db_generation(db::DbType::REGISTER_INPUT) == 0);
+
+    // Any write to the table, single or ranged, changes its generation.
+    bank.db_update(db::DbType::REGISTER, 500, std::uint16_t{1});
+    auto after_single = bank.db_generation(db::DbType::REGISTER);
+    CHECK(after_single != generation);
+    bank.db_write_range(db::DbType::REGISTER, 0, values);
+    CHECK(bank.db_generation(db::DbType::REGISTER) != after_single);
+
+    // Databases without a generation are never cached.
+    ElementDatabase element;
+    CHECK_FALSE(element.db_generation(db::DbType::REGISTER).has_value());
+}
+
+TEST_CASE("Mapped register bank keeps its tables across reopen") {
+    auto path = (std::filesystem::temp_directory_path() / "az_mapped_register_bank_test.bin").string();
+    std::filesystem::remove(path);
+
+    std::array<std::uint16_t, 3> values = {7, 8, 9};
+    std::array<std::uint8_t, 1> packed = {0x05};
+    {
+        db::MappedRegisterBank bank(path, db::SyncPolicy::EveryWrite);
+        CHECK(bank.created());
+        CHECK(bank.db_write_range(db::DbType::REGISTER, 65533, values));
+        CHECK(bank.db_write_bits(db::DbType::BITS, 100, 3, packed));
+        CHECK(bank.db_update(db::DbType::REGISTER_INPUT, 42, std::uint16_t{0xBEEF}));
+
+        // The file is owned by one bank at a time.
+        CHECK_THROWS(db::MappedRegisterBank{path});
+    }
+    {
+        db::MappedRegisterBank bank(path, db::SyncPolicy::Periodic, std::chrono::milliseconds(10));
+        CHECK_FALSE(bank.created());
+        std::array<std::uint16_t, 3> read{};
+        CHECK(bank.db_read_range(db::DbType::REGISTER, 65533, read));
+        CHECK(read == values);
+        std::array<std::uint8_t, 1> bits{};
+        CHECK(bank.db_read_bits(db::DbType::BITS, 100, 3, bits));
+        CHECK(bits[0] == 0x05);
+        CHECK(std::get<std::uint16_t>(bank.db_read(db::DbType::REGISTER_INPUT, 42)) == 0xBEEF);
+    }
+
+    // Files of another format are rejected instead of being reinterpreted.
+    std::filesystem::resize_file(path, 4096);
+    CHECK_THROWS(db::MappedRegisterBank{path});
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Shared register bank serves a producer process' ranges without tearing") {
+    const std::string name = "/az_shared_bank_test_" + std::to_string(getpid());
+    db::SharedRegisterBank::remove(name);
+    db::SharedRegisterBank server(name);
+    CHECK(server.created());
+
+    constexpr std::uint16_t UPDATES = 20000;
+    auto begin = std::chrono::steady_clock::now();
+    pid_t producer = fork();
+    REQUIRE(producer >= 0);
+    if (producer == 0) {
+        // Acquisition process: publishes whole input blocks where every register holds the update number.
+        try {
+            db::SharedRegisterBank bank(name);
+            std::array<std::uint16_t, modbus::MAX_READ_REGISTERS> values;
+            for (std::uint16_t update = 1; update <= UPDATES; ++update) {
+                values.fill(update);
+                bank.db_write_range(db::DbType::REGISTER_INPUT, 1000, values);
+            }
+            _exit(0);
+        } catch (...) {
+            _exit(1);
+        }
+    }
+
+    std::array<std::uint16_t, modbus::MAX_READ_REGISTERS> snapshot;
+    size_t torn = 0;
+    size_t reads = 0;
+    auto deadline = begin + std::chrono::seconds(30);
+    do {
+        server.db_read_range(db::DbType::REGISTER_INPUT, 1000, snapshot);
+        torn += std::any_of(snapshot.begin(), snapshot.end(), [&](std::uint16_t v) { return v != snapshot[0]; });
+        ++reads;
+    } while (snapshot[0] != UPDATES && std::chrono::steady_clock::now() < deadline);
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    int status = 0;
+    waitpid(producer, &status, 0);
+    CHECK(WIFEXITED(status));
+    CHECK(WEXITSTATUS(status) == 0);
+    CHECK(snapshot[0] == UPDATES);
+    CHECK(torn == 0);
+    CHECK(server.db_generation(db::DbType::REGISTER_INPUT) == UPDATES);
+    std::cout << "Shared bank: " << static_cast<size_t>(UPDATES / elapsed) << " block updates/s published, "
+              << static_cast<size_t>(reads / elapsed) << " block reads/s served" << std::endl;
+
+    CHECK(db::SharedRegisterBank::remove(name));
+}
+
+// Maps the layout of a shared register bank the way another process writing it would see it.
+static db::RegisterBankLayout* map_shared_layout(const std::string& name) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) return nullptr;
+    void* mapping = mmap(nullptr, db::MappedBankHeader::LAYOUT_OFFSET + sizeof(db::RegisterBankLayout),
+        PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) return nullptr;
+    return reinterpret_cast<db::RegisterBankLayout*>(static_cast<std::uint8_t*>(mapping) + db::MappedBankHeader::LAYOUT_OFFSET);
+}
+
+// Runs the operation on another thread, false when it has not completed within the timeout.
+static bool completes_within(std::chrono::milliseconds timeout, std::function<void()> operation) {
+    auto done = std::make_shared<std::promise<void>>();
+    auto completed = done->get_future();
+    std::thread worker([done, operation] {
+        operation();
+        done->set_value();
+    });
+    bool ready = completed.wait_for(timeout) == std::future_status::ready;
+    if (ready) worker.join();
+    else worker.detach();
+    return ready;
+}
+
+TEST_CASE("Shared register bank releases range writes left by a dead process") {
+    const std::string name = "/az_shared_bank_crash_test_" + std::to_string(getpid());
+    db::SharedRegisterBank::remove(name);
+    // Shared with the operations timed by completes_within(), which may outlive the test when they hang.
+    auto server = std::make_shared<db::SharedRegisterBank>(name, true);
+    auto read = std::make_shared<std::array<std::uint16_t, 4>>();
+    auto* layout = map_shared_layout(name);
+    REQUIRE(layout != nullptr);
+    std::atomic_ref<std::uint64_t> sequence(layout->input_registers.sequence);
+
+    // A live writer in the middle of a range write holds the readers back until it ends.
+    sequence.store((std::uint64_t(getpid()) << 32) | 1);
+    std::thread reader([&] { server->db_read_range(db::DbType::REGISTER_INPUT, 0, *read); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    CHECK(sequence.load() == ((std::uint64_t(getpid()) << 32) | 1));
+    sequence.store(2);
+    reader.join();
+
+    // A producer killed in the middle of a range write.
+    pid_t producer = fork();
+    REQUIRE(producer >= 0);
+    if (producer == 0) {
+        sequence.store((std::uint64_t(getpid()) << 32) | 3);
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(producer, &status, 0);
+    REQUIRE((sequence.load() & 1) == 1);
+    auto generation = server->db_generation(db::DbType::REGISTER_INPUT);
+
+    // Readers and writers of the table release the write instead of waiting forever.
+    REQUIRE(completes_within(std::chrono::seconds(5), [server, read] { server->db_read_range(db::DbType::REGISTER_INPUT, 0, *read); }));
+    CHECK((sequence.load() & 1) == 0);
+    CHECK(server->db_generation(db::DbType::REGISTER_INPUT) != generation);
+
+    sequence.store((std::uint64_t(producer) << 32) | 5);
+    std::array<std::uint16_t, 4> values = {1, 2, 3, 4};
+    REQUIRE(completes_within(std::chrono::seconds(5), [server, values] { server->db_write_range(db::DbType::REGISTER_INPUT, 0, values); }));
+    CHECK(server->db_read_range(db::DbType::REGISTER_INPUT, 0, *read));
+    CHECK(*read == values);
+
+    munmap(reinterpret_cast<std::uint8_t*>(layout) - db::MappedBankHeader::LAYOUT_OFFSET,
+        db::MappedBankHeader::LAYOUT_OFFSET + sizeof(db::RegisterBankLayout));
+    CHECK(db::SharedRegisterBank::remove(name));
+}
+
+TEST_CASE("Seqlock writer wrongly reported gone moves the counter when it ends its write") {
+    auto table = std::make_unique<db::BankTable<std::uint16_t>>();
+    std::atomic_ref<std::uint64_t> sequence(table->sequence);
+    db::WriterGone always_gone = [](std::uint32_t) { return true; };
+    db::SeqlockTable<std::uint16_t> reader(table.get(), 1, always_gone);
+
+    // The writer stalls before its first store, long enough to be reported gone.
+    std::promise<void> stalled, resume;
+    auto resumed = resume.get_future().share();
+    std::thread writer([&] {
+        db::SeqlockTable<std::uint16_t> table_writer(table.get(), 2, always_gone);
+        table_writer.write_range(0, 4, [&](size_t i) {
+            if (i == 0) {
+                stalled.set_value();
+                resumed.wait();
+            }
+            return std::uint16_t{1};
+        });
+    });
+    stalled.get_future().wait();
+
+    std::array<std::uint16_t, 4> values{};
+    reader.copy_to(0, values);
+    CHECK(values == std::array<std::uint16_t, 4>{0, 0, 0, 0});
+    auto released = sequence.load();
+    REQUIRE((released & 1) == 0);
+
+    // A copy of the released table that overlaps the end of the write is retried.
+    size_t copies = 0;
+    reader.read_range(0, 4, [&](size_t i, std::uint16_t value) {
+        if (i == 0 && copies++ == 0) {
+            resume.set_value();
+            writer.join();
+        }
+        values[i] = value;
+    });
+    CHECK(copies == 2);
+    CHECK(values == std::array<std::uint16_t, 4>{1, 1, 1, 1});
+    CHECK((sequence.load() & 1) == 0);
+    CHECK(sequence.load() != released);
+}
+
+TEST_CASE("Write subscriptions deliver coalesced batches of the subscribed range") {
+    modbus::WriteSubscription subscription(1, db::DbType::REGISTER, 100, 50, 8);
+    std::vector<modbus::WriteEvent> batch;
+    CHECK(subscription.drain(batch) == 0);
+
+    subscription.publish(1, db::DbType::REGISTER, 110, 1);
+    subscription.publish(1, db::DbType::REGISTER, 110, 1);   // Same address again
+    subscription.publish(1, db::DbType::REGISTER, 111, 4);   // Adjacent
+    subscription.publish(1, db::DbType::REGISTER, 90, 15);   // Clipped to [100, 105)
+    subscription.publish(2, db::DbType::REGISTER, 110, 1);   // Other unit
+    subscription.publish(1, db::DbType::BITS, 110, 1);       // Other table
+    subscription.publish(1, db::DbType::REGISTER, 150, 10);  // Out of range
+    REQUIRE(subscription.drain(batch) == 2);
+    CHECK(batch[0].start == 100);
+    CHECK(batch[0].count == 5);
+    CHECK(batch[1].start == 110);
+    CHECK(batch[1].count == 5);
+    CHECK(subscription.drain(batch) == 0);
+
+    // An overflow reports the whole range instead of dropping writes.
+    for (std::uint16_t i = 0; i < 20; ++i) {
+        subscription.publish(1, db::DbType::REGISTER, static_cast<std::uint16_t>(100 + 2 * i), 1);
+    }
+    REQUIRE(subscription.drain(batch) == 1);
+    CHECK(batch[0].start == 100);
+    CHECK(batch[0].count == 50);
+}
+
+TEST_CASE("Write subscription queue accepts concurrent producers") {
+    constexpr int PRODUCERS = 4;
+    constexpr std::uint16_t WRITES = 5000;
+    auto subscription = std::make_shared<modbus::WriteSubscription>(1, db::DbType::BITS, 0, PRODUCERS * WRITES, 1 << 16);
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; ++p) {
+        producers.emplace_back([&, p] {
+            for (std::uint16_t i = 0; i < WRITES; ++i) {
+                subscription->publish(1, db::DbType::BITS, static_cast<std::uint16_t>(p * WRITES + i), 1);
+            }
+        });
+    }
+
+    // Every address is reported once it has been written, in one merged range at the end.
+    std::vector<bool> seen(PRODUCERS * WRITES, false);
+    std::vector<modbus::WriteEvent> batch;
+    std::uint32_t signal = 0;
+    size_t reported = 0;
+    while (reported < seen.size()) {
+        signal = subscription->wait(signal);
+        subscription->drain(batch);
+        for (const auto& event : batch) {
+            for (std::uint32_t a = event.start; a < event.start + event.count; ++a) {
+                reported += !seen[a];
+                seen[a] = true;
+            }
+        }
+    }
+    for (auto& producer : producers) producer.join();
+    CHECK(reported == seen.size());
+    CHECK(subscription->drain(batch) == 0);
+}
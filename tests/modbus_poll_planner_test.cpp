@@ -0,0 +1,89 @@
+#include <vector>
+#include <variant>
+#include <stdexcept>
+
+#include "../src/az_poll_planner.hpp"
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+using modbus::FunctionCode;
+
+TEST_CASE("Planner merges adjacent and overlapping tags of one table") {
+    std::vector<modbus::PollTag> tags = {
+        {FunctionCode::HoldingRegisters, 10, 2},
+        {FunctionCode::HoldingRegisters, 12, 3},
+        {FunctionCode::HoldingRegisters, 13, 4},
+        {FunctionCode::HoldingRegisters, 30, 1},
+        {FunctionCode::InputRegisters, 10, 2},
+    };
+
+    auto plan = modbus::PollPlanner().plan(tags);
+    REQUIRE(plan.request_count() == 3u);
+    REQUIRE(plan.naive_request_count() == 5u);
+    REQUIRE(plan.requests_saved() == 2u);
+
+    REQUIRE(plan.requests[0].function_code == FunctionCode::HoldingRegisters);
+    REQUIRE(plan.requests[0].address == 10u);
+    REQUIRE(plan.requests[0].quantity == 7u);
+    REQUIRE((plan.requests[0].tags == std::vector<size_t>{0, 1, 2}));
+    REQUIRE(plan.requests[1].address == 30u);
+    REQUIRE(plan.requests[2].function_code == FunctionCode::InputRegisters);
+}
+
+TEST_CASE("Planner gap tolerance and protocol limits") {
+    std::vector<modbus::PollTag> tags = {
+        {FunctionCode::HoldingRegisters, 100, 1},
+        {FunctionCode::HoldingRegisters, 105, 1},
+        {FunctionCode::HoldingRegisters, 200, 10},
+        {FunctionCode::ReadCoils, 0, 1000},
+        {FunctionCode::ReadCoils, 1000, 1000},
+        {FunctionCode::ReadCoils, 2000, 1},
+    };
+
+    REQUIRE(modbus::PollPlanner(0).plan(tags).request_count() == 5u);
+
+    // A tolerance of 4 skips the hole 101-104, not the one before 200.
+    // Requests are ordered by function code: coils first.
+    auto plan = modbus::PollPlanner(4).plan(tags);
+    REQUIRE(plan.request_count() == 4u);
+    REQUIRE(plan.requests[2].address == 100u);
+    REQUIRE(plan.requests[2].quantity == 6u);
+
+    // Registers 100-209 fit in 125, coils 0-2000 do not fit in 2000.
+    auto wide = modbus::PollPlanner(125, 10).plan(tags);
+    REQUIRE(wide.request_count() == 3u);
+    REQUIRE(wide.requests[0].quantity == 2000u);
+    REQUIRE(wide.requests[1].address == 2000u);
+    REQUIRE(wide.requests[2].quantity == 110u);
+
+    std::vector<modbus::PollTag> too_big = {{FunctionCode::HoldingRegisters, 0, 126}};
+    REQUIRE_THROWS(modbus::PollPlanner().plan(too_big));
+}
+
+TEST_CASE("Planner scatters request values back to the tags") {
+    std::vector<modbus::PollTag> tags = {
+        {FunctionCode::InputRegisters, 7, 2},
+        {FunctionCode::InputRegisters, 5, 3},
+        {FunctionCode::ReadDiscreteInputs, 3, 2},
+    };
+    auto plan = modbus::PollPlanner().plan(tags);
+    REQUIRE(plan.request_count() == 2u);
+
+    std::vector<modbus::PollValue> values;
+    for (size_t i = 0; i < plan.requests.size(); ++i) {
+        const auto& request = plan.requests[i];
+        if (request.function_code == FunctionCode::InputRegisters) {
+            // Register n holds n * 10.
+            std::vector<std::uint16_t> registers(request.quantity);
+            for (size_t r = 0; r < registers.size(); ++r) registers[r] = static_cast<std::uint16_t>((request.address + r) * 10);
+            modbus::PollPlanner::scatter(plan, i, registers, values);
+        } else {
+            modbus::PollPlanner::scatter(plan, i, std::vector<std::uint8_t>{1, 0}, values);
+        }
+    }
+
+    REQUIRE((std::get<std::vector<std::uint16_t>>(values[0]) == std::vector<std::uint16_t>{70, 80}));
+    REQUIRE((std::get<std::vector<std::uint16_t>>(values[1]) == std::vector<std::uint16_t>{50, 60, 70}));
+    REQUIRE((std::get<std::vector<std::uint8_t>>(values[2]) == std::vector<std::uint8_t>{1, 0}));
+}
@@ -1,8 +1,11 @@
 #include <vector>
 #include <algorithm>
+#include <numeric>
 #include <variant>
+#include <random>
 
 #include "../src/az_modbus_protocol.hpp"
+#include "../src/az_modbus_frame_parser.hpp"
 #include "../src/az_helper.hpp"
 
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
@@ -106,6 +109,17 @@ TEST_CASE("FC 0x01: Read Coils Response") {
     REQUIRE(data_response[1] == 0);
 }
 
+TEST_CASE("FC 0x01: Read Coils Response byte count not matching the quantity") {
+    std::vector<uint8_t> short_pdu = { 0x01, 0x01, 0xFF };
+    std::vector<uint8_t> long_pdu = { 0x01, 0x03, 0xFF, 0x01, 0x00 };
+    std::uint16_t quantity = 10u;
+
+    REQUIRE_THROWS(modbus::decode_read_coils_view(short_pdu, quantity));
+    REQUIRE_THROWS(modbus::decode_read_coils_response(short_pdu, quantity));
+    REQUIRE_THROWS(modbus::decode_read_coils_packed(long_pdu, quantity));
+    REQUIRE_THROWS(modbus::decode_read_data_response(short_pdu, quantity, modbus::FunctionCode::ReadCoils));
+}
+
 TEST_CASE("FC 0x02: Read Discrete Inputs Request") {
     //Expected result:                     tid       prot_id      lenght   unit   fc
     std::vector<uint8_t> expect_msg = {0x00, 0x01, 0x00, 0x00, 0x00, 0x06, 0x01, 0x02, 0x00, 0x14, 0x00, 0x03};
@@ -315,6 +329,13 @@ TEST_CASE("FC 0x04: Input Registers Response") {
     REQUIRE(data_response[0] == 1);
 }
 
+TEST_CASE("FC 0x04: Input Registers Response shorter than requested") {
+    std::vector<uint8_t> expect_pdu = { 0x04, 0x02, 0x00, 0x01 };
+    std::uint16_t quantity = 2u;
+
+    REQUIRE_THROWS(modbus::decode_read_register_response(expect_pdu, quantity));
+}
+
 TEST_CASE("FC 0x05: Write Single Coil") {
     //Expected result:                     tid       prot_id      lenght   unit   fc
     std::vector<uint8_t> expect_msg = {0x00, 0x04, 0x00, 0x00, 0x00, 0x06, 0x01, 0x05, 0x00, 0x08, 0xFF, 0x00};
@@ -398,3 +419,462 @@ TEST_CASE("FC 0x06: Write Holding Register Process exception") {
     }
 }
 
+
+TEST_CASE("Span encoders write the expected ADU bytes") {
+    modbus::AduFrame frame{};
+
+    // Only the first size bytes of the frame may be written.
+    auto written = [&frame](size_t size, const std::vector<uint8_t>& expect_msg) {
+        return size == expect_msg.size()
+            && std::equal(expect_msg.begin(), expect_msg.end(), frame.begin())
+            && std::all_of(frame.begin() + size, frame.end(), [](uint8_t byte) { return byte == 0xAA; });
+    };
+
+    modbus::MbapHeader header_data;
+    header_data.transaction_id = 0x1234u;
+    header_data.protocol_id = 0u;
+    header_data.length = 0u;
+    header_data.unit_id = 1u;
+
+    modbus::RequestData pdu_data;
+    pdu_data.start_addr = 3u;
+    pdu_data.value = 0u;
+
+    //Expected result:                   tid       prot_id     length    unit   fc     addr        qty
+    std::vector<uint8_t> read_msg = {0x00, 0x07, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x0B, 0x00, 0x04};
+    frame.fill(0xAA);
+    auto size = modbus::encode_read_adu(frame, 7u, 1u, 11u, 4u, modbus::FunctionCode::HoldingRegisters);
+    REQUIRE(written(size, read_msg) == true);
+
+    //Expected result:                    tid       prot_id     length    unit   fc     addr        val
+    std::vector<uint8_t> write_msg = {0x00, 0x08, 0x00, 0x00, 0x00, 0x06, 0x01, 0x05, 0x00, 0x09, 0xFF, 0x00};
+    frame.fill(0xAA);
+    size = modbus::encode_write_adu(frame, 8u, 1u, 9u, 1u, modbus::FunctionCode::WriteSingleCoil);
+    REQUIRE(written(size, write_msg) == true);
+
+    pdu_data.func_code = modbus::FunctionCode::ReadCoils;
+    pdu_data.number = 11u;
+    std::vector<uint8_t> bits = {1, 0, 1, 1, 0, 0, 0, 1, 0, 1, 1};
+    //Expected result:                   tid       prot_id     length    unit   fc    bytes  bits 0-7  bits 8-10
+    std::vector<uint8_t> bits_msg = {0x12, 0x34, 0x00, 0x00, 0x00, 0x05, 0x01, 0x01, 0x02, 0x8D, 0x06};
+    frame.fill(0xAA);
+    size = modbus::encode_read_bits(frame, header_data, pdu_data, bits);
+    REQUIRE(written(size, bits_msg) == true);
+
+    pdu_data.func_code = modbus::FunctionCode::InputRegisters;
+    pdu_data.number = 3u;
+    std::vector<uint16_t> registers = {0x0102, 0xA0B0, 0xFFFF};
+    //Expected result:                        tid       prot_id     length    unit   fc    bytes    val1        val2        val3
+    std::vector<uint8_t> registers_msg = {0x12, 0x34, 0x00, 0x00, 0x00, 0x09, 0x01, 0x04, 0x06, 0x01, 0x02, 0xA0, 0xB0, 0xFF, 0xFF};
+    frame.fill(0xAA);
+    size = modbus::encode_read_registers(frame, header_data, pdu_data, registers);
+    REQUIRE(written(size, registers_msg) == true);
+
+    modbus::Exceptiondata exception{modbus::EXC_ILLEGAL_DATA_ADDRESS, "EXC_ILLEGAL_DATA_ADDRESS"};
+    //Expected result:                        tid       prot_id     length    unit   fc    code
+    std::vector<uint8_t> exception_msg = {0x12, 0x34, 0x00, 0x00, 0x00, 0x03, 0x01, 0x84, 0x02};
+    frame.fill(0xAA);
+    size = modbus::encode_exception_adu(frame, header_data, modbus::FunctionCode::InputRegisters, exception);
+    REQUIRE(written(size, exception_msg) == true);
+}
+
+TEST_CASE("Exception ADU without the requested function code answers Read Coils") {
+    modbus::MbapHeader header_data{0x1234, 0x0000, 0x0006, 0x01};
+    modbus::Exceptiondata exception{modbus::EXC_ILLEGAL_DATA_ADDRESS, "EXC_ILLEGAL_DATA_ADDRESS"};
+    //Expected result:                        tid       prot_id     length    unit   fc    code
+    std::vector<uint8_t> exception_msg = {0x12, 0x34, 0x00, 0x00, 0x00, 0x03, 0x01, 0x81, 0x02};
+
+    REQUIRE(modbus::create_modbus_exception_adu(header_data, exception) == exception_msg);
+}
+
+TEST_CASE("Span encoders reject a short buffer") {
+    std::array<std::uint8_t, 8> small{};
+    bool thrown = false;
+    try {
+        modbus::encode_read_adu(small, 0u, 1u, 1u, 1u, modbus::FunctionCode::ReadCoils);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    REQUIRE(thrown == true);
+}
+
+TEST_CASE("MBAP header and PDU views over a whole ADU") {
+    //                               tid       prot_id      lenght   unit   fc   byte    val1        val2
+    std::vector<uint8_t> adu = {0x00, 0x09, 0x00, 0x00, 0x00, 0x07, 0x01, 0x03, 0x04, 0x00, 0x0A, 0x12, 0x34};
+
+    modbus::MbapHeaderView header(adu);
+    REQUIRE(header.transaction_id() == 9u);
+    REQUIRE(header.length() == 7u);
+    REQUIRE(header.unit_id() == 1u);
+    REQUIRE(header.pdu_size() == 6u);
+    REQUIRE(header.pdu().size() == 6u);
+
+    modbus::PduView pdu(header.pdu());
+    REQUIRE(pdu.function_code() == modbus::FunctionCode::HoldingRegisters);
+    REQUIRE(pdu.is_exception() == false);
+    REQUIRE(pdu.has_valid_byte_count() == true);
+
+    auto registers = modbus::decode_read_register_view(header.pdu());
+    REQUIRE(registers.size() == 2u);
+    REQUIRE(registers[0] == 0x000A);
+    REQUIRE(registers[1] == 0x1234);
+    REQUIRE(registers.bytes().data() == adu.data() + 9);
+}
+
+TEST_CASE("Bit view over a read coils response") {
+    std::vector<uint8_t> pdu = {0x01, 0x02, 0xCD, 0x01};
+    auto bits = modbus::decode_read_coils_view(pdu, 10u);
+
+    REQUIRE(bits.size() == 10u);
+    std::vector<bool> expected = {1, 0, 1, 1, 0, 0, 1, 1, 1, 0};
+    for (size_t i = 0; i < expected.size(); ++i) {
+        REQUIRE(bits[i] == expected[i]);
+    }
+}
+
+TEST_CASE("Views reject malformed buffers") {
+    std::vector<uint8_t> short_header = {0x00, 0x01, 0x00, 0x00, 0x00};
+    std::vector<uint8_t> bad_protocol = {0x00, 0x01, 0x00, 0x01, 0x00, 0x06, 0x01};
+    std::vector<uint8_t> bad_count = {0x03, 0x04, 0x00, 0x01};
+    std::vector<uint8_t> exception = {0x83, 0x02};
+
+    int thrown = 0;
+    try { modbus::MbapHeaderView view(short_header); } catch (const std::runtime_error&) { thrown++; }
+    try { modbus::MbapHeaderView view(bad_protocol); } catch (const std::runtime_error&) { thrown++; }
+    try { modbus::decode_read_register_view(bad_count); } catch (const std::runtime_error&) { thrown++; }
+    try { modbus::decode_read_register_view(exception); } catch (const std::runtime_error&) { thrown++; }
+    REQUIRE(thrown == 4);
+}
+
+TEST_CASE("Frame parser splits coalesced frames") {
+    auto first = modbus::create_read_adu(1u, 1u, 5u, 2u, modbus::FunctionCode::ReadCoils);
+    auto second = modbus::create_write_adu(2u, 1u, 7u, 200u, modbus::FunctionCode::WriteSingleRegister);
+
+    std::vector<uint8_t> stream(first);
+    stream.insert(stream.end(), second.begin(), second.end());
+
+    modbus::FrameParser parser;
+    parser.feed(stream);
+
+    auto frame = parser.next_frame();
+    REQUIRE(frame.has_value());
+    REQUIRE((std::equal(frame->begin(), frame->end(), first.begin(), first.end())) == true);
+
+    frame = parser.next_frame();
+    REQUIRE(frame.has_value());
+    REQUIRE((std::equal(frame->begin(), frame->end(), second.begin(), second.end())) == true);
+
+    REQUIRE(parser.next_frame().has_value() == false);
+    REQUIRE(parser.buffered() == 0u);
+}
+
+TEST_CASE("Frame parser reassembles frames fed in random chunks") {
+    std::mt19937 rng(1234);
+    std::vector<std::vector<uint8_t>> frames;
+    std::vector<uint8_t> stream;
+
+    modbus::MbapHeader header_data{0u, 0u, 0u, 1u};
+    modbus::RequestData pdu_data{modbus::FunctionCode::HoldingRegisters, 0u, 0u, 0u};
+
+    for (std::uint16_t i = 0; i < 200; ++i) {
+        header_data.transaction_id = i;
+        pdu_data.number = 1 + (i % 125);
+        std::vector<uint16_t> registers(pdu_data.number, i);
+        frames.push_back(modbus::handle_read_registers(header_data, pdu_data, registers));
+        stream.insert(stream.end(), frames.back().begin(), frames.back().end());
+    }
+
+    modbus::FrameParser parser(16);
+    size_t offset = 0;
+    size_t index = 0;
+    while (offset < stream.size()) {
+        size_t chunk = std::min<size_t>(stream.size() - offset, 1 + rng() % 700);
+        auto space = parser.prepare(chunk);
+        std::copy_n(stream.begin() + offset, chunk, space.begin());
+        parser.commit(chunk);
+        offset += chunk;
+
+        while (auto frame = parser.next_frame()) {
+            REQUIRE(index < frames.size());
+            REQUIRE((std::equal(frame->begin(), frame->end(), frames[index].begin(), frames[index].end())) == true);
+            index++;
+        }
+    }
+    REQUIRE(index == frames.size());
+    REQUIRE(parser.buffered() == 0u);
+}
+
+TEST_CASE("Frame parser rejects a corrupted stream") {
+    std::vector<uint8_t> bad_protocol = {0x00, 0x01, 0x00, 0x01, 0x00, 0x06, 0x01};
+    std::vector<uint8_t> bad_length = {0x00, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01};
+
+    int thrown = 0;
+    modbus::FrameParser parser;
+    parser.feed(bad_protocol);
+    try { parser.next_frame(); } catch (const std::runtime_error&) { thrown++; }
+
+    parser.reset();
+    parser.feed(bad_length);
+    try { parser.next_frame(); } catch (const std::runtime_error&) { thrown++; }
+    REQUIRE(thrown == 2);
+}
+
+TEST_CASE("Frame parser reports a corrupted stream without throwing") {
+    std::vector<uint8_t> valid = {0x00, 0x01, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x01, 0x00, 0x01};
+    std::vector<uint8_t> bad_protocol = {0x00, 0x02, 0x00, 0x01, 0x00, 0x06, 0x01};
+    std::vector<uint8_t> bad_length = {0x00, 0x03, 0x00, 0x00, 0x00, 0x01, 0x01};
+
+    modbus::FrameParser parser;
+    parser.feed(valid);
+    parser.feed(bad_protocol);
+    auto frame = parser.try_next_frame();
+    REQUIRE(frame.has_value());
+    REQUIRE(frame->has_value());
+    REQUIRE(parser.try_next_frame().error() == modbus::DecodeError::InvalidProtocolId);
+
+    parser.reset();
+    parser.feed(bad_length);
+    REQUIRE(parser.try_next_frame().error() == modbus::DecodeError::InvalidLength);
+}
+
+TEST_CASE("Read quantity limits depend on the function code") {
+    //                                   fc       addr       num
+    std::vector<uint8_t> registers_126 = {0x03, 0x00, 0x01, 0x00, 0x7E};
+    std::vector<uint8_t> coils_126 = {0x01, 0x00, 0x01, 0x00, 0x7E};
+
+    REQUIRE(std::holds_alternative<modbus::Exceptiondata>(modbus::decode_request(registers_126)) == true);
+    REQUIRE(std::holds_alternative<modbus::RequestData>(modbus::decode_request(coils_126)) == true);
+}
+
+TEST_CASE("SIMD bit kernels match the reference bit loop") {
+    std::mt19937 rng(42);
+    for (size_t count : {0u, 1u, 7u, 8u, 9u, 15u, 16u, 17u, 31u, 32u, 33u, 63u, 64u, 65u, 100u, 2000u}) {
+        std::vector<std::uint8_t> bits(count);
+        for (auto& bit : bits) {
+            // Any non zero byte counts as a set bit.
+            bit = (rng() % 2) ? static_cast<std::uint8_t>(1 + rng() % 255) : 0;
+        }
+
+        std::vector<std::uint8_t> expected((count + 7) / 8, 0);
+        for (size_t i = 0; i < count; ++i) {
+            if (bits[i]) expected[i / 8] |= static_cast<std::uint8_t>(1 << (i % 8));
+        }
+
+        std::vector<std::uint8_t> packed(expected.size(), 0xFF);
+        modbus::simd::pack_bits(bits, packed);
+        REQUIRE(packed == expected);
+
+        std::fill(packed.begin(), packed.end(), 0xFF);
+        modbus::simd::scalar::pack_bits(bits, packed);
+        REQUIRE(packed == expected);
+
+        std::vector<std::uint8_t> unpacked(count, 0xFF);
+        modbus::simd::unpack_bits(expected, unpacked);
+        for (size_t i = 0; i < count; ++i) {
+            REQUIRE(unpacked[i] == (bits[i] != 0 ? 1 : 0));
+        }
+
+        std::fill(unpacked.begin(), unpacked.end(), 0xFF);
+        modbus::simd::scalar::unpack_bits(expected, unpacked);
+        for (size_t i = 0; i < count; ++i) {
+            REQUIRE(unpacked[i] == (bits[i] != 0 ? 1 : 0));
+        }
+    }
+}
+
+TEST_CASE("Read coils response can be decoded as packed bits") {
+    modbus::MbapHeader header{1, 0, 0, 1};
+    modbus::RequestData request{modbus::FunctionCode::ReadCoils, 0, 10, 0};
+    std::vector<std::uint8_t> coils = {1, 0, 1, 1, 0, 0, 1, 1, 1, 0};
+    auto adu = modbus::handle_read_bits(header, request, coils);
+
+    auto packed = modbus::decode_read_coils_packed(modbus::MbapHeaderView(adu).pdu(), 10);
+    REQUIRE(packed.size() == 10u);
+    REQUIRE(packed.bytes().size() == 2u);
+    REQUIRE(packed[2] == true);
+    REQUIRE(packed[9] == false);
+    REQUIRE(packed.unpack() == coils);
+}
+
+TEST_CASE("Register byte swap kernels match the per register conversion") {
+    for (size_t count : {0u, 1u, 7u, 8u, 9u, 15u, 16u, 17u, 33u, 123u, 125u}) {
+        std::vector<std::uint16_t> registers(count);
+        for (size_t i = 0; i < count; ++i) {
+            registers[i] = static_cast<std::uint16_t>(0x0102 * (i + 1) + i);
+        }
+
+        std::vector<std::uint8_t> wire(count * 2);
+        modbus::simd::store_big_endian(registers, wire);
+        for (size_t i = 0; i < count; ++i) {
+            REQUIRE(modbus::from_big_endian(wire[i * 2], wire[i * 2 + 1]) == registers[i]);
+        }
+
+        std::vector<std::uint16_t> host(count);
+        modbus::simd::load_big_endian(wire, host);
+        REQUIRE(host == registers);
+    }
+
+    // 125 register response through the encoder and the view.
+    std::vector<std::uint16_t> registers(125);
+    for (size_t i = 0; i < registers.size(); ++i) registers[i] = static_cast<std::uint16_t>(i * 517);
+    modbus::MbapHeader header{1, 0, 0, 1};
+    modbus::RequestData request{modbus::FunctionCode::HoldingRegisters, 0, 125, 0};
+    auto adu = modbus::handle_read_registers(header, request, registers);
+    REQUIRE(modbus::decode_read_register_response(modbus::MbapHeaderView(adu).pdu(), 125) == registers);
+}
+
+TEST_CASE("Write multiple requests round trip through decode_request") {
+    std::vector<std::uint16_t> registers = {0x1234, 0xABCD, 0x0001};
+    auto adu = modbus::create_write_multiple_registers_adu(7, 1, 100, registers);
+    REQUIRE(adu.size() == 7u + 6u + 6u);
+    REQUIRE(modbus::MbapHeaderView(adu).length() == 13u);
+
+    auto data = std::get<modbus::RequestData>(modbus::decode_request(modbus::MbapHeaderView(adu).pdu()));
+    REQUIRE(data.func_code == modbus::FunctionCode::WriteMultipleRegisters);
+    REQUIRE(data.start_addr == 100u);
+    REQUIRE(data.number == 3u);
+    REQUIRE(data.payload.size() == 6u);
+    REQUIRE((data.payload[0] == 0x12 && data.payload[1] == 0x34));
+
+    std::vector<std::uint8_t> coils = {1, 0, 1, 1, 0, 0, 1, 1, 1, 0};
+    auto coil_adu = modbus::create_write_multiple_coils_adu(8, 1, 20, coils);
+    auto coil_data = std::get<modbus::RequestData>(modbus::decode_request(modbus::MbapHeaderView(coil_adu).pdu()));
+    REQUIRE(coil_data.func_code == modbus::FunctionCode::WriteMultipleCoils);
+    REQUIRE(coil_data.number == 10u);
+    REQUIRE((coil_data.payload.size() == 2u && coil_data.payload[0] == 0xCD && coil_data.payload[1] == 0x01));
+
+    // Byte count not matching the quantity.
+    auto bad = adu;
+    bad[12] = 4;
+    auto exception = modbus::decode_request(modbus::MbapHeaderView(bad).pdu());
+    REQUIRE(std::get<modbus::Exceptiondata>(exception).code == modbus::EXC_ILLEGAL_DATA_VALUE);
+
+    // Response echoes FC, address and quantity.
+    modbus::AduFrame response;
+    size_t size = modbus::encode_write_multiple_response(response, modbus::decode_header(adu), data);
+    auto pdu = modbus::MbapHeaderView(std::span<const std::uint8_t>(response).first(size)).pdu();
+    modbus::check_write_multiple_response(pdu, modbus::FunctionCode::WriteMultipleRegisters, 100, 3);
+    REQUIRE_THROWS(modbus::check_write_multiple_response(pdu, modbus::FunctionCode::WriteMultipleRegisters, 100, 4));
+}
+
+TEST_CASE("Write multiple requests are split at the protocol limits") {
+    std::vector<std::uint16_t> registers(250);
+    auto requests = modbus::create_write_multiple_requests<std::uint16_t>(1, 1000, registers);
+    REQUIRE(requests.size() == 3u);
+
+    std::vector<std::pair<std::uint16_t, std::uint16_t>> chunks;
+    for (auto& request : requests) {
+        modbus::PduView pdu(modbus::MbapHeaderView(request).pdu());
+        chunks.emplace_back(pdu.start_addr(), pdu.number());
+    }
+    REQUIRE((chunks == std::vector<std::pair<std::uint16_t, std::uint16_t>>{{1000, 123}, {1123, 123}, {1246, 4}}));
+
+    std::vector<std::uint8_t> coils(2000);
+    REQUIRE(modbus::create_write_multiple_requests<std::uint8_t>(1, 0, coils).size() == 2u);
+
+    REQUIRE_THROWS(modbus::create_write_multiple_requests<std::uint16_t>(1, 0xFFFF, registers));
+}
+
+TEST_CASE("Read/Write Multiple Registers request and response") {
+    std::vector<std::uint16_t> setpoints = {500, 600};
+    auto adu = modbus::create_read_write_registers_adu(3, 1, 10, 4, 20, setpoints);
+    REQUIRE(adu.size() == 7u + 10u + 4u);
+
+    auto data = std::get<modbus::RequestData>(modbus::decode_request(modbus::MbapHeaderView(adu).pdu()));
+    REQUIRE(data.func_code == modbus::FunctionCode::ReadWriteMultipleRegisters);
+    REQUIRE(data.start_addr == 10u);
+    REQUIRE(data.number == 4u);
+    REQUIRE(data.write_addr == 20u);
+    REQUIRE(data.write_number == 2u);
+    std::vector<std::uint16_t> written(2);
+    modbus::simd::load_big_endian(data.payload, written);
+    REQUIRE(written == setpoints);
+
+    auto bad = adu;
+    bad[16] = 2; // Byte count for one register while two are announced
+    REQUIRE(std::holds_alternative<modbus::Exceptiondata>(modbus::decode_request(modbus::MbapHeaderView(bad).pdu())));
+
+    std::vector<std::uint16_t> status = {1, 2, 3, 4};
+    auto response = modbus::handle_read_registers(modbus::decode_header(adu), data, status);
+    auto decoded = modbus::decode_read_data_response(modbus::MbapHeaderView(response).pdu(), 4, modbus::FunctionCode::ReadWriteMultipleRegisters);
+    REQUIRE(std::get<std::vector<std::uint16_t>>(decoded) == status);
+}
+
+TEST_CASE("Large reads are split and reassembled in address order") {
+    auto requests = modbus::create_read_requests(2, 100, 300, modbus::FunctionCode::HoldingRegisters);
+    REQUIRE(requests.size() == 3u);
+
+    // Answer every chunk with its own addresses, as a server would.
+    std::vector<std::vector<std::uint8_t>> responses;
+    for (auto& request : requests) {
+        auto data = std::get<modbus::RequestData>(modbus::decode_request(modbus::MbapHeaderView(request).pdu()));
+        std::vector<std::uint16_t> values(data.number);
+        std::iota(values.begin(), values.end(), data.start_addr);
+        responses.push_back(modbus::handle_read_registers(modbus::decode_header(request), data, values));
+    }
+    auto registers = std::get<std::vector<std::uint16_t>>(
+        modbus::decode_read_responses(requests, responses, modbus::FunctionCode::HoldingRegisters));
+    std::vector<std::uint16_t> expected(300);
+    std::iota(expected.begin(), expected.end(), 100);
+    REQUIRE(registers == expected);
+
+    std::swap(responses[1], responses[2]);
+    REQUIRE_THROWS(modbus::decode_read_responses(requests, responses, modbus::FunctionCode::HoldingRegisters));
+
+    auto coil_requests = modbus::create_read_requests(2, 0, 4001, modbus::FunctionCode::ReadCoils);
+    REQUIRE(coil_requests.size() == 3u);
+    REQUIRE_THROWS(modbus::create_read_requests(2, 0xFF00, 300, modbus::FunctionCode::HoldingRegisters));
+}
+
+TEST_CASE("Non-throwing decoders report errors as values") {
+    std::vector<std::uint8_t> short_header = {0x00, 0x01, 0x00, 0x00, 0x00};
+    REQUIRE(modbus::try_decode_header(short_header).error() == modbus::DecodeError::BufferTooShort);
+    std::vector<std::uint8_t> bad_protocol = {0x00, 0x01, 0x12, 0x34, 0x00, 0x06, 0x01};
+    REQUIRE(modbus::try_decode_header(bad_protocol).error() == modbus::DecodeError::InvalidProtocolId);
+
+    auto adu = modbus::create_read_adu(9, 1, 10, 4, modbus::FunctionCode::HoldingRegisters);
+    auto header = modbus::try_decode_header(adu);
+    REQUIRE(header.has_value());
+    REQUIRE(header->transaction_id == 9u);
+    auto request = modbus::try_decode_request(modbus::MbapHeaderView(adu).pdu());
+    REQUIRE(request.has_value());
+    REQUIRE(request->number == 4u);
+
+    std::vector<std::uint8_t> unknown_fc = {0x2B, 0x0E, 0x01, 0x00, 0x00};
+    REQUIRE(modbus::try_decode_request(unknown_fc).error() == modbus::EXC_ILLEGAL_FUNCTION);
+    std::vector<std::uint8_t> zero_quantity = {0x03, 0x00, 0x00, 0x00, 0x00};
+    REQUIRE(modbus::try_decode_request(zero_quantity).error() == modbus::EXC_ILLEGAL_DATA_VALUE);
+    std::vector<std::uint8_t> truncated = {0x03, 0x00};
+    REQUIRE(modbus::try_decode_request(truncated).error() == modbus::EXC_ILLEGAL_DATA_VALUE);
+    // Short requests of unsupported function codes are rejected by their function code.
+    std::vector<std::uint8_t> report_server_id = {0x11};
+    REQUIRE(modbus::try_decode_request(report_server_id).error() == modbus::EXC_ILLEGAL_FUNCTION);
+    std::vector<std::uint8_t> read_exception_status = {0x07};
+    REQUIRE(modbus::try_decode_request(read_exception_status).error() == modbus::EXC_ILLEGAL_FUNCTION);
+
+    // Exception responses echo the requested function code with the high bit set.
+    modbus::AduFrame frame;
+    size_t size = modbus::encode_exception_adu(frame, *header, modbus::FunctionCode::HoldingRegisters, modbus::EXC_ILLEGAL_DATA_ADDRESS);
+    auto pdu = std::span<const std::uint8_t>(frame).subspan(modbus::MBAP_HEADER_SIZE, size - modbus::MBAP_HEADER_SIZE);
+    REQUIRE(pdu[0] == 0x83);
+    REQUIRE(modbus::try_check_exception(pdu).error() == modbus::EXC_ILLEGAL_DATA_ADDRESS);
+    REQUIRE_THROWS(modbus::check_exception(pdu));
+}
+
+TEST_CASE("Response frame header and payload join into the contiguous ADU") {
+    modbus::MbapHeader header{7, 0, 0, 1};
+    modbus::RequestData request{modbus::FunctionCode::HoldingRegisters, 1, 3, 0};
+    std::vector<std::uint16_t> registers = {0x0102, 0xA0B0, 0xFFFF};
+
+    modbus::AduFrame expected;
+    size_t size = modbus::encode_read_registers(expected, header, request, registers);
+
+    auto values = registers;
+    modbus::ResponseFrame frame;
+    REQUIRE(modbus::encode_read_response_frame(frame, header, request.func_code, modbus::simd::to_big_endian_in_place(values)) == size);
+
+    std::vector<std::uint8_t> joined(frame.header_bytes().begin(), frame.header_bytes().end());
+    joined.insert(joined.end(), frame.payload.begin(), frame.payload.end());
+    REQUIRE(std::equal(joined.begin(), joined.end(), expected.begin(), expected.begin() + size));
+    REQUIRE(static_cast<const void*>(frame.payload.data()) == static_cast<const void*>(values.data()));
+}
@@ -0,0 +1,61 @@
+#include <vector>
+
+#include "../src/az_modbus_server.hpp"
+#include "../src/az_register_bank.hpp"
+
+#include "loopback_server.hpp"
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+TEST_CASE("Server answers pipelined requests in order with one write") {
+    LoopbackServer loopback;
+    std::vector<std::uint16_t> registers = {0x0102, 0x0304};
+    loopback.add_unit(1).db_write_range(db::DbType::REGISTER, 0, registers);
+    loopback.start();
+
+    //Request:                       tid       prot_id     length    unit   fc     addr        qty
+    std::vector<uint8_t> read_1 = {0x00, 0x10, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x01, 0x00, 0x02};
+    //                               tid       prot_id     length    unit   fc     addr        val
+    std::vector<uint8_t> write  = {0x00, 0x11, 0x00, 0x00, 0x00, 0x06, 0x01, 0x06, 0x00, 0x03, 0xAB, 0xCD};
+    //                               tid       prot_id     length    unit   fc
+    std::vector<uint8_t> bad_fc = {0x00, 0x12, 0x00, 0x00, 0x00, 0x02, 0x01, 0x07};
+    //                               tid       prot_id     length    unit   fc     addr        qty
+    std::vector<uint8_t> read_2 = {0x00, 0x13, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x03, 0x00, 0x01};
+
+    auto written = loopback.serve(join({read_1, write, bad_fc, read_2}));
+
+    //Expected result:
+    auto expected = join({
+        //  tid       prot_id     length    unit   fc    bytes    val1        val2
+        {0x00, 0x10, 0x00, 0x00, 0x00, 0x07, 0x01, 0x03, 0x04, 0x01, 0x02, 0x03, 0x04},
+        write,
+        //  tid       prot_id     length    unit   fc    code
+        {0x00, 0x12, 0x00, 0x00, 0x00, 0x03, 0x01, 0x87, 0x01},
+        //  tid       prot_id     length    unit   fc    bytes    val
+        {0x00, 0x13, 0x00, 0x00, 0x00, 0x05, 0x01, 0x03, 0x02, 0xAB, 0xCD}});
+    REQUIRE(written.size() == 1u);
+    REQUIRE(written[0] == expected);
+}
+
+TEST_CASE("Server flushes after 32 batched responses") {
+    LoopbackServer loopback;
+    loopback.add_unit(1);
+    loopback.start();
+
+    // 33 pipelined reads of one register, tid = index.
+    std::vector<uint8_t> requests;
+    std::vector<uint8_t> responses;
+    for (std::uint8_t tid = 0; tid < 33; ++tid) {
+        std::vector<uint8_t> request  = {0x00, tid, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x01, 0x00, 0x01};
+        std::vector<uint8_t> response = {0x00, tid, 0x00, 0x00, 0x00, 0x05, 0x01, 0x03, 0x02, 0x00, 0x00};
+        requests.insert(requests.end(), request.begin(), request.end());
+        responses.insert(responses.end(), response.begin(), response.end());
+    }
+
+    auto written = loopback.serve(requests);
+    REQUIRE(written.size() == 2u);
+    REQUIRE(written[0].size() == 32u * 11u);
+    REQUIRE(written[1].size() == 11u);
+    REQUIRE(join({written[0], written[1]}) == responses);
+}
@@ -0,0 +1,384 @@
+#include <vector>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include "../src/az_modbus_context.hpp"
+#include "../src/az_asio_server_transport.hpp"
+#include "../src/az_modbus_server.hpp"
+#include "../src/az_register_bank.hpp"
+#include "../src/az_response_cache.hpp"
+
+#include "loopback_server.hpp"
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+/**
+ * @brief Executors of the connections accepted by a server transport, filled from the I/O threads
+ */
+class AcceptLog {
+private:
+    std::mutex mutex_;
+    std::condition_variable accepted_;
+    std::vector<asio::any_io_executor> executors_;
+    std::vector<std::unique_ptr<modbus::IModbusChannel>> channels_;
+
+public:
+    modbus::IServerTransport::NewConnectionHandler handler() {
+        return [this](std::unique_ptr<modbus::IModbusChannel> channel) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            executors_.push_back(channel->get_executor());
+            channels_.push_back(std::move(channel));
+            accepted_.notify_all();
+        };
+    }
+
+    // Waits until count connections were accepted, false on timeout.
+    bool wait_for(size_t count) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return accepted_.wait_for(lock, std::chrono::seconds(5), [&] { return executors_.size() >= count; });
+    }
+
+    // Number of connections accepted onto the io_context.
+    size_t on(asio::io_context& io) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return std::count(executors_.begin(), executors_.end(), asio::any_io_executor(io.get_executor()));
+    }
+};
+
+// Stops the context when a test ends, its accept loops never complete on their own.
+struct StopContext {
+    modbus::ModbusContext& context;
+    ~StopContext() { context.stop(); }
+};
+
+TEST_CASE("Single accept mode spreads sequential connections over every io_context") {
+    modbus::ModbusContext context(2);
+    modbus::AsioServerTransport transport(context, modbus::AcceptMode::Single);
+    AcceptLog log;
+    StopContext stop{context};
+    transport.start_accepting("127.0.0.1", "15802", log.handler());
+
+    // One connection at a time, each one finds an empty backlog after it.
+    asio::io_context client_io;
+    std::vector<asio::ip::tcp::socket> clients;
+    constexpr size_t connections = 8;
+    for (size_t i = 0; i < connections; ++i) {
+        auto& client = clients.emplace_back(client_io);
+        client.connect(asio::ip::tcp::endpoint(asio::ip::make_address("127.0.0.1"), 15802));
+        REQUIRE(log.wait_for(i + 1) == true);
+    }
+
+    REQUIRE(log.on(context.get_io_context(0)) == connections / 2);
+    REQUIRE(log.on(context.get_io_context(1)) == connections / 2);
+}
+
+TEST_CASE("Sharded accept mode accepts onto the context io_contexts") {
+    modbus::ModbusContext context(2);
+    modbus::AsioServerTransport transport(context, modbus::AcceptMode::Sharded);
+    AcceptLog log;
+    StopContext stop{context};
+    transport.start_accepting("127.0.0.1", "15803", log.handler());
+
+    asio::io_context client_io;
+    std::vector<asio::ip::tcp::socket> clients;
+    constexpr size_t connections = 8;
+    for (size_t i = 0; i < connections; ++i) {
+        clients.emplace_back(client_io).connect(asio::ip::tcp::endpoint(asio::ip::make_address("127.0.0.1"), 15803));
+    }
+
+    REQUIRE(log.wait_for(connections) == true);
+    REQUIRE(log.on(context.get_io_context(0)) + log.on(context.get_io_context(1)) == connections);
+}
+
+TEST_CASE("Accept loops keep running when start_accepting is called again") {
+    modbus::ModbusContext context(2);
+    modbus::AsioServerTransport transport(context, modbus::AcceptMode::Sharded);
+    AcceptLog log;
+    StopContext stop{context};
+    transport.start_accepting("127.0.0.1", "15804", log.handler());
+    transport.start_accepting("127.0.0.1", "15805", log.handler());
+
+    // Both endpoints keep accepting, the first loops still refer to their acceptors.
+    asio::io_context client_io;
+    std::vector<asio::ip::tcp::socket> clients;
+    constexpr size_t connections = 8;
+    for (size_t i = 0; i < connections; ++i) {
+        std::uint16_t port = (i % 2) ? 15805 : 15804;
+        clients.emplace_back(client_io).connect(asio::ip::tcp::endpoint(asio::ip::make_address("127.0.0.1"), port));
+    }
+
+    REQUIRE(log.wait_for(connections) == true);
+}
+
+TEST_CASE("Server answers an unsupported function code with EXC_ILLEGAL_FUNCTION") {
+    LoopbackServer loopback;
+    loopback.add_unit(1);
+    loopback.start();
+
+    //Request:                         tid       prot_id     length    unit   fc
+    std::vector<uint8_t> request  = {0x00, 0x01, 0x00, 0x00, 0x00, 0x02, 0x01, 0x11};
+    //Expected result:                 tid       prot_id     length    unit   fc    code
+    std::vector<uint8_t> response = {0x00, 0x01, 0x00, 0x00, 0x00, 0x03, 0x01, 0x91, 0x01};
+
+    auto written = loopback.serve(request);
+    REQUIRE(written.size() == 1u);
+    REQUIRE(written[0] == response);
+}
+
+TEST_CASE("Server answers a quantity over the limit with EXC_ILLEGAL_DATA_VALUE") {
+    LoopbackServer loopback;
+    loopback.add_unit(1);
+    loopback.start();
+
+    //Request:                         tid       prot_id     length    unit   fc     addr        qty
+    std::vector<uint8_t> request  = {0x00, 0x02, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x01, 0x00, 0x7E};
+    //Expected result:                 tid       prot_id     length    unit   fc    code
+    std::vector<uint8_t> response = {0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x01, 0x83, 0x03};
+
+    auto written = loopback.serve(request);
+    REQUIRE(written.size() == 1u);
+    REQUIRE(written[0] == response);
+}
+
+TEST_CASE("Server answers an address out of the table with EXC_ILLEGAL_DATA_ADDRESS") {
+    LoopbackServer loopback;
+    loopback.add_unit(1);
+    loopback.start();
+
+    //Request:                         tid       prot_id     length    unit   fc     addr        qty
+    std::vector<uint8_t> request  = {0x00, 0x03, 0x00, 0x00, 0x00, 0x06, 0x01, 0x04, 0xFF, 0xFF, 0x00, 0x03};
+    //Expected result:                 tid       prot_id     length    unit   fc    code
+    std::vector<uint8_t> response = {0x00, 0x03, 0x00, 0x00, 0x00, 0x03, 0x01, 0x84, 0x02};
+
+    auto written = loopback.serve(request);
+    REQUIRE(written.size() == 1u);
+    REQUIRE(written[0] == response);
+}
+
+TEST_CASE("Server answers the requests before a corrupted header and closes the connection") {
+    LoopbackServer loopback;
+    loopback.add_unit(1);
+    loopback.start();
+
+    //Request:                        tid       prot_id     length    unit   fc     addr        qty
+    std::vector<uint8_t> request  = {0x00, 0x08, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x01, 0x00, 0x01};
+    std::vector<uint8_t> corrupt  = {0x00, 0x09, 0x12, 0x34, 0x00, 0x06, 0x01, 0x03, 0x00, 0x01, 0x00, 0x01};
+    //Expected result:                tid       prot_id     length    unit   fc    bytes    val
+    std::vector<uint8_t> response = {0x00, 0x08, 0x00, 0x00, 0x00, 0x05, 0x01, 0x03, 0x02, 0x00, 0x00};
+
+    // Nothing after the corrupted header is answered.
+    auto written = loopback.serve(join({request, corrupt, request}));
+    REQUIRE(written.size() == 1u);
+    REQUIRE(written[0] == response);
+}
+
+TEST_CASE("Server serves FC 0x0F and 0x10 writes") {
+    LoopbackServer loopback;
+    loopback.add_unit(1);
+    loopback.start();
+
+    //Request:                            tid       prot_id     length    unit   fc     addr        qty     bytes    val1        val2
+    std::vector<uint8_t> registers  = {0x00, 0x20, 0x00, 0x00, 0x00, 0x0B, 0x01, 0x10, 0x00, 0x0A, 0x00, 0x02, 0x04, 0x11, 0x11, 0x22, 0x22};
+    //                                    tid       prot_id     length    unit   fc     addr        qty     bytes  bits 0-7  bits 8-9
+    std::vector<uint8_t> coils      = {0x00, 0x21, 0x00, 0x00, 0x00, 0x09, 0x01, 0x0F, 0x00, 0x01, 0x00, 0x0A, 0x02, 0xCD, 0x01};
+    //                                    tid       prot_id     length    unit   fc     addr        qty
+    std::vector<uint8_t> read_coils = {0x00, 0x22, 0x00, 0x00, 0x00, 0x06, 0x01, 0x01, 0x00, 0x01, 0x00, 0x0A};
+    std::vector<uint8_t> read_regs  = {0x00, 0x23, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x0A, 0x00, 0x02};
+
+    auto written = loopback.serve(join({registers, coils, read_coils, read_regs}));
+
+    //Expected result:
+    auto expected = join({
+        //  tid       prot_id     length    unit   fc     addr        qty
+        {0x00, 0x20, 0x00, 0x00, 0x00, 0x06, 0x01, 0x10, 0x00, 0x0A, 0x00, 0x02},
+        {0x00, 0x21, 0x00, 0x00, 0x00, 0x06, 0x01, 0x0F, 0x00, 0x01, 0x00, 0x0A},
+        //  tid       prot_id     length    unit   fc    bytes  bits 0-7  bits 8-9
+        {0x00, 0x22, 0x00, 0x00, 0x00, 0x05, 0x01, 0x01, 0x02, 0xCD, 0x01},
+        //  tid       prot_id     length    unit   fc    bytes    val1        val2
+        {0x00, 0x23, 0x00, 0x00, 0x00, 0x07, 0x01, 0x03, 0x04, 0x11, 0x11, 0x22, 0x22}});
+    REQUIRE(written.size() == 1u);
+    REQUIRE(written[0] == expected);
+}
+
+TEST_CASE("Server FC 0x17 writes nothing when either range is out of the table") {
+    LoopbackServer loopback;
+    auto& bank = loopback.add_unit(1);
+    loopback.start();
+
+    //Request:                           tid       prot_id     length    unit   fc    read addr   read qty   write addr  write qty  bytes    val
+    std::vector<uint8_t> bad_read  = {0x00, 0x30, 0x00, 0x00, 0x00, 0x0D, 0x01, 0x17, 0xFF, 0xFF, 0x00, 0x03, 0x00, 0x01, 0x00, 0x01, 0x02, 0x12, 0x34};
+    std::vector<uint8_t> bad_write = {0x00, 0x31, 0x00, 0x00, 0x00, 0x11, 0x01, 0x17, 0x00, 0x01, 0x00, 0x01, 0xFF, 0xFF, 0x00, 0x03, 0x06, 0x11, 0x11, 0x22, 0x22, 0x33, 0x33};
+    std::vector<uint8_t> valid     = {0x00, 0x32, 0x00, 0x00, 0x00, 0x0D, 0x01, 0x17, 0x00, 0x01, 0x00, 0x02, 0x00, 0x02, 0x00, 0x01, 0x02, 0x12, 0x34};
+
+    auto written = loopback.serve(join({bad_read, bad_write, valid}));
+
+    //Expected result:
+    auto expected = join({
+        //  tid       prot_id     length    unit   fc    code
+        {0x00, 0x30, 0x00, 0x00, 0x00, 0x03, 0x01, 0x97, 0x02},
+        {0x00, 0x31, 0x00, 0x00, 0x00, 0x03, 0x01, 0x97, 0x02},
+        //  tid       prot_id     length    unit   fc    bytes    val1        val2
+        {0x00, 0x32, 0x00, 0x00, 0x00, 0x07, 0x01, 0x17, 0x04, 0x00, 0x00, 0x12, 0x34}});
+    REQUIRE(written.size() == 1u);
+    REQUIRE(written[0] == expected);
+    REQUIRE(std::get<std::uint16_t>(bank.db_read(db::DbType::REGISTER, 0)) == 0u);
+    REQUIRE(std::get<std::uint16_t>(bank.db_read(db::DbType::REGISTER, 0xFFFE)) == 0u);
+}
+
+TEST_CASE("Cached read responses hit until their table is written") {
+    db::RegisterBank bank;
+    std::array<std::uint16_t, 2> values = {0x1234, 0x5678};
+    bank.db_write_range(db::DbType::REGISTER, 10, values);
+
+    modbus::ResponseCache cache(16);
+    modbus::ResponseCacheKey key{1, modbus::HoldingRegisters, 11, 2};
+    std::array<std::uint8_t, 4> payload = {0x12, 0x34, 0x56, 0x78};
+    modbus::ResponseFrame encoded;
+    modbus::encode_read_response_frame(encoded, modbus::MbapHeader{0x0001, 0, 0, 1}, modbus::HoldingRegisters, payload);
+
+    auto generation = bank.db_generation(db::DbType::REGISTER);
+    REQUIRE(generation.has_value());
+    modbus::ResponseFrame frame;
+    std::array<std::uint8_t, 250> storage;
+    CHECK_FALSE(cache.lookup(key, *generation, 0x0002, frame, storage));
+    cache.insert(key, *generation, encoded);
+
+    // A hit copies the response with the new transaction ID.
+    REQUIRE(cache.lookup(key, *generation, 0xABCD, frame, storage));
+    CHECK(frame.header[0] == 0xAB);
+    CHECK(frame.header[1] == 0xCD);
+    CHECK(std::equal(frame.header_bytes().begin() + 2, frame.header_bytes().end(), encoded.header_bytes().begin() + 2));
+    CHECK(std::equal(frame.payload.begin(), frame.payload.end(), payload.begin(), payload.end()));
+
+    // Other requests miss, and so does the entry once the table is written.
+    CHECK_FALSE(cache.lookup({1, modbus::HoldingRegisters, 11, 3}, *generation, 0x0003, frame, storage));
+    bank.db_update(db::DbType::REGISTER, 500, std::uint16_t{1});
+    CHECK_FALSE(cache.lookup(key, *bank.db_generation(db::DbType::REGISTER), 0x0004, frame, storage));
+
+    auto stats = cache.stats();
+    CHECK(stats.hits == 1);
+    CHECK(stats.misses == 3);
+}
+
+TEST_CASE("Server serves cached reads with the request TID until an FC 0x06 write") {
+    LoopbackServer loopback;
+    std::vector<std::uint16_t> registers = {0x1234, 0x5678};
+    loopback.add_unit(1).db_write_range(db::DbType::REGISTER, 10, registers);
+    loopback.server.enable_response_cache();
+    loopback.start();
+
+    //Request:                      tid       prot_id     length    unit   fc     addr        qty
+    std::vector<uint8_t> read_1 = {0x00, 0x01, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x0B, 0x00, 0x02};
+    std::vector<uint8_t> read_2 = {0x00, 0x02, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x0B, 0x00, 0x02};
+    //                              tid       prot_id     length    unit   fc     addr        val
+    std::vector<uint8_t> write  = {0x00, 0x03, 0x00, 0x00, 0x00, 0x06, 0x01, 0x06, 0x00, 0x0B, 0x43, 0x21};
+    //                              tid       prot_id     length    unit   fc     addr        qty
+    std::vector<uint8_t> read_3 = {0x00, 0x04, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x0B, 0x00, 0x02};
+
+    //Expected result:                     tid       prot_id     length    unit   fc    bytes    val1        val2
+    std::vector<uint8_t> response_1 = {0x00, 0x01, 0x00, 0x00, 0x00, 0x07, 0x01, 0x03, 0x04, 0x12, 0x34, 0x56, 0x78};
+    std::vector<uint8_t> response_2 = {0x00, 0x02, 0x00, 0x00, 0x00, 0x07, 0x01, 0x03, 0x04, 0x12, 0x34, 0x56, 0x78};
+    std::vector<uint8_t> response_3 = {0x00, 0x04, 0x00, 0x00, 0x00, 0x07, 0x01, 0x03, 0x04, 0x43, 0x21, 0x56, 0x78};
+
+    // Responses are shared by every connection.
+    REQUIRE(loopback.serve(read_1) == std::vector<std::vector<uint8_t>>{response_1});
+    REQUIRE(loopback.serve(read_2) == std::vector<std::vector<uint8_t>>{response_2});
+    auto stats = loopback.server.response_cache_stats();
+    CHECK(stats.hits == 1);
+    CHECK(stats.misses == 1);
+
+    REQUIRE(loopback.serve(write) == std::vector<std::vector<uint8_t>>{write});
+    REQUIRE(loopback.serve(read_3) == std::vector<std::vector<uint8_t>>{response_3});
+    stats = loopback.server.response_cache_stats();
+    CHECK(stats.hits == 1);
+    CHECK(stats.misses == 2);
+}
+
+TEST_CASE("Server never caches exception responses") {
+    LoopbackServer loopback;
+    loopback.add_unit(1);
+    loopback.server.enable_response_cache();
+    loopback.start();
+
+    //Request:                       tid       prot_id     length    unit   fc     addr        qty
+    std::vector<uint8_t> request  = {0x00, 0x05, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0xFF, 0xFF, 0x00, 0x03};
+    //Expected result:                 tid       prot_id     length    unit   fc    code
+    std::vector<uint8_t> response = {0x00, 0x05, 0x00, 0x00, 0x00, 0x03, 0x01, 0x83, 0x02};
+
+    // The cache is looked up before the range check, an out-of-range read misses every time.
+    auto written = loopback.serve(join({request, request}));
+    REQUIRE(written.size() == 1u);
+    REQUIRE(written[0] == join({response, response}));
+    auto stats = loopback.server.response_cache_stats();
+    CHECK(stats.hits == 0);
+    CHECK(stats.misses == 2);
+}
+
+TEST_CASE("Server publishes the database range of every write applied") {
+    LoopbackServer loopback;
+    loopback.add_unit(1);
+    loopback.add_unit(2);
+    auto registers = loopback.server.subscribe_writes(modbus::UnitID(1), db::DbType::REGISTER, 0, 0x10000);
+    auto coils = loopback.server.subscribe_writes(modbus::UnitID(1), db::DbType::BITS, 0, 0x10000);
+    auto other_unit = loopback.server.subscribe_writes(modbus::UnitID(2), db::DbType::REGISTER, 0, 0x10000);
+    loopback.start();
+
+    // (start, count) of the writes published since the last call.
+    using Ranges = std::vector<std::pair<std::uint32_t, std::uint32_t>>;
+    auto published = [](modbus::WriteSubscription& subscription) {
+        std::vector<modbus::WriteEvent> batch;
+        subscription.drain(batch);
+        Ranges ranges;
+        for (const auto& event : batch) ranges.emplace_back(event.start, event.count);
+        return ranges;
+    };
+
+    //Request:                       tid       prot_id     length    unit   fc     addr        qty     bytes    val1        val2
+    std::vector<uint8_t> fc_10 = {0x00, 0x40, 0x00, 0x00, 0x00, 0x0B, 0x01, 0x10, 0x00, 0x0A, 0x00, 0x02, 0x04, 0x11, 0x11, 0x22, 0x22};
+    REQUIRE(loopback.serve(fc_10).size() == 1u);
+    CHECK(published(*registers) == Ranges{{9, 2}});
+    CHECK(published(*coils).empty());
+
+    //                               tid       prot_id     length    unit   fc     addr        qty     bytes  bits 0-7  bits 8-9
+    std::vector<uint8_t> fc_0f = {0x00, 0x41, 0x00, 0x00, 0x00, 0x09, 0x01, 0x0F, 0x00, 0x01, 0x00, 0x0A, 0x02, 0xCD, 0x01};
+    REQUIRE(loopback.serve(fc_0f).size() == 1u);
+    CHECK(published(*coils) == Ranges{{0, 10}});
+    CHECK(published(*registers).empty());
+
+    //                               tid       prot_id     length    unit   fc    read addr   read qty   write addr  write qty  bytes    val1        val2        val3
+    std::vector<uint8_t> fc_17 = {0x00, 0x42, 0x00, 0x00, 0x00, 0x11, 0x01, 0x17, 0x00, 0x01, 0x00, 0x01, 0x00, 0x64, 0x00, 0x03, 0x06, 0x00, 0x01, 0x00, 0x02, 0x00, 0x03};
+    REQUIRE(loopback.serve(fc_17).size() == 1u);
+    CHECK(published(*registers) == Ranges{{99, 3}});
+
+    //                               tid       prot_id     length    unit   fc     addr        val
+    std::vector<uint8_t> fc_05 = {0x00, 0x43, 0x00, 0x00, 0x00, 0x06, 0x01, 0x05, 0x00, 0x05, 0xFF, 0x00};
+    std::vector<uint8_t> fc_06 = {0x00, 0x44, 0x00, 0x00, 0x00, 0x06, 0x01, 0x06, 0x00, 0x07, 0x00, 0x2A};
+    REQUIRE(loopback.serve(join({fc_05, fc_06})).size() == 1u);
+    CHECK(published(*coils) == Ranges{{4, 1}});
+    CHECK(published(*registers) == Ranges{{6, 1}});
+
+    // Writes answered with an exception publish nothing.
+    //                                   tid       prot_id     length    unit   fc     addr        qty     bytes    val1        val2        val3
+    std::vector<uint8_t> bad_fc_10 = {0x00, 0x45, 0x00, 0x00, 0x00, 0x0D, 0x01, 0x10, 0xFF, 0xFF, 0x00, 0x03, 0x06, 0x00, 0x01, 0x00, 0x02, 0x00, 0x03};
+    //                                   tid       prot_id     length    unit   fc     addr        qty     bytes    bits
+    std::vector<uint8_t> bad_fc_0f = {0x00, 0x46, 0x00, 0x00, 0x00, 0x09, 0x01, 0x0F, 0xFF, 0xFF, 0x00, 0x10, 0x02, 0xFF, 0xFF};
+    //                                   tid       prot_id     length    unit   fc    read addr   read qty   write addr  write qty  bytes    val
+    std::vector<uint8_t> bad_fc_17 = {0x00, 0x47, 0x00, 0x00, 0x00, 0x0D, 0x01, 0x17, 0xFF, 0xFF, 0x00, 0x03, 0x00, 0x01, 0x00, 0x01, 0x02, 0x12, 0x34};
+
+    auto written = loopback.serve(join({bad_fc_10, bad_fc_0f, bad_fc_17}));
+
+    //Expected result:
+    auto expected = join({
+        //  tid       prot_id     length    unit   fc    code
+        {0x00, 0x45, 0x00, 0x00, 0x00, 0x03, 0x01, 0x90, 0x02},
+        {0x00, 0x46, 0x00, 0x00, 0x00, 0x03, 0x01, 0x8F, 0x02},
+        {0x00, 0x47, 0x00, 0x00, 0x00, 0x03, 0x01, 0x97, 0x02}});
+    REQUIRE(written.size() == 1u);
+    REQUIRE(written[0] == expected);
+    CHECK(published(*registers).empty());
+    CHECK(published(*coils).empty());
+    CHECK(published(*other_unit).empty());
+}
@@ -0,0 +1,47 @@
+#include <vector>
+
+#include "../src/az_modbus_server.hpp"
+#include "../src/az_register_bank.hpp"
+
+#include "loopback_server.hpp"
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+TEST_CASE("Server routes requests by unit ID and answers unknown units with 0x0B") {
+    LoopbackServer loopback;
+    std::vector<std::uint16_t> first = {0x0101};
+    std::vector<std::uint16_t> second = {0x0202};
+    loopback.add_unit(1).db_write_range(db::DbType::REGISTER, 0, first);
+    loopback.add_unit(2).db_write_range(db::DbType::REGISTER, 0, second);
+    loopback.start();
+
+    //Request:                       tid       prot_id     length    unit   fc     addr        qty
+    std::vector<uint8_t> unit_1 = {0x00, 0x04, 0x00, 0x00, 0x00, 0x06, 0x01, 0x03, 0x00, 0x01, 0x00, 0x01};
+    std::vector<uint8_t> unit_2 = {0x00, 0x05, 0x00, 0x00, 0x00, 0x06, 0x02, 0x03, 0x00, 0x01, 0x00, 0x01};
+    std::vector<uint8_t> unit_5 = {0x00, 0x06, 0x00, 0x00, 0x00, 0x06, 0x05, 0x03, 0x00, 0x01, 0x00, 0x01};
+
+    //Expected result:                   tid       prot_id     length    unit   fc    bytes    val
+    std::vector<uint8_t> response_1 = {0x00, 0x04, 0x00, 0x00, 0x00, 0x05, 0x01, 0x03, 0x02, 0x01, 0x01};
+    std::vector<uint8_t> response_2 = {0x00, 0x05, 0x00, 0x00, 0x00, 0x05, 0x02, 0x03, 0x02, 0x02, 0x02};
+    //                                   tid       prot_id     length    unit   fc    code
+    std::vector<uint8_t> response_5 = {0x00, 0x06, 0x00, 0x00, 0x00, 0x03, 0x05, 0x83, 0x0B};
+
+    REQUIRE(loopback.serve(unit_1) == std::vector<std::vector<uint8_t>>{response_1});
+    REQUIRE(loopback.serve(unit_2) == std::vector<std::vector<uint8_t>>{response_2});
+    REQUIRE(loopback.serve(unit_5) == std::vector<std::vector<uint8_t>>{response_5});
+}
+
+TEST_CASE("Server applies writes to the addressed unit only") {
+    LoopbackServer loopback;
+    auto& unit_1 = loopback.add_unit(1);
+    auto& unit_2 = loopback.add_unit(2);
+    loopback.start();
+
+    //Request:                     tid       prot_id     length    unit   fc     addr        val
+    std::vector<uint8_t> write = {0x00, 0x07, 0x00, 0x00, 0x00, 0x06, 0x02, 0x06, 0x00, 0x01, 0xAB, 0xCD};
+
+    REQUIRE(loopback.serve(write) == std::vector<std::vector<uint8_t>>{write});
+    CHECK(std::get<std::uint16_t>(unit_1.db_read(db::DbType::REGISTER, 0)) == 0x0000);
+    CHECK(std::get<std::uint16_t>(unit_2.db_read(db::DbType::REGISTER, 0)) == 0xABCD);
+}